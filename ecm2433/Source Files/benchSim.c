@@ -0,0 +1,324 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "runSimulations.h"
+
+/*
+ * benchSim measures the throughput of the simulator core and writes it as JSON, one result per line:
+ *     {"name": "runOneSimulation/tick/a50p5-a40p6", "metric": "ticks_per_sec", "value": 1234567.0},
+ * With --compare BASELINE it also reads a file written by an earlier run and reports every result that has dropped
+ * by more than the tolerance (10% by default) or is no longer measured, exiting with a failure status if any have.
+ *
+ * Usage: benchSim [--time SECONDS] [--compare BASELINE] [--tolerance FRACTION]
+*/
+
+/* The most results one run of the benchmarks produces */
+#define MAX_RESULTS 256
+
+/* The size of the name of a benchmark, which every buffer holding one uses */
+#define NAME_SIZE 128
+
+/* The number of vehicles pushed and popped per round of the queue benchmarks */
+#define QUEUE_ROUND 4096
+
+/*
+ * BenchResult is one measured figure
+*/
+struct BenchResult {
+    char name[NAME_SIZE];
+    char metric[32];
+    double value;
+};
+
+/*
+ * BenchCase is one configuration of the benchmark matrix, saturated cases have more arrivals than the lights can
+ * clear so their queues grow for the whole arrival period
+*/
+struct BenchCase {
+    int arrivalRateLHS;
+    int lightPeriodLHS;
+    int arrivalRateRHS;
+    int lightPeriodRHS;
+    const char *label;
+};
+
+static const struct BenchCase CASES[] = {
+    {5, 5, 5, 5, "light"},
+    {30, 10, 20, 10, "moderate"},
+    {50, 5, 40, 6, "heavy"},
+    {30, 2, 30, 20, "unbalanced"},
+    {90, 2, 90, 2, "saturated"},
+    {99, 20, 99, 20, "saturated"}
+};
+#define NUM_CASES ((int)(sizeof(CASES) / sizeof(CASES[0])))
+
+static struct BenchResult results[MAX_RESULTS];
+static int numResults = 0;
+
+/**
+ * now gets the current time of a monotonic clock
+ * @return - the time in seconds
+ */
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * add_result records one measured figure
+ * @param name - the name of the benchmark
+ * @param metric - the name of the figure, e.g. "ticks_per_sec"
+ * @param value - the figure, larger is always better
+ */
+static void add_result(const char *name, const char *metric, double value){
+    if(numResults == MAX_RESULTS){
+        return;
+    }
+    strncpy(results[numResults].name, name, sizeof(results[numResults].name) - 1);
+    results[numResults].name[sizeof(results[numResults].name) - 1] = '\0';
+    strncpy(results[numResults].metric, metric, sizeof(results[numResults].metric) - 1);
+    results[numResults].metric[sizeof(results[numResults].metric) - 1] = '\0';
+    results[numResults].value = value;
+    numResults++;
+}
+
+/**
+ * case_name builds the name of a benchmark of one case of the matrix
+ * @param buffer - receives the name, NAME_SIZE chars long, which the short prefixes and labels always fit in
+ * @param prefix - the name of what is being measured
+ * @param c - the case
+ */
+static void case_name(char buffer[NAME_SIZE], const char *prefix, const struct BenchCase *c){
+    sprintf(buffer, "%.40s/a%dp%d-a%dp%d-%.20s", prefix, c->arrivalRateLHS, c->lightPeriodLHS,
+            c->arrivalRateRHS, c->lightPeriodRHS, c->label);
+}
+
+/**
+ * bench_one_simulation measures runOneSimulation on one case, counting the iterations each replication ran for
+ * (every arrival iteration plus the longer of the two clearance times) and the vehicles it simulated
+ * @param c - the case
+ * @param engine - the engine to use
+ * @param seconds - how long to keep running replications for
+ */
+static void bench_one_simulation(const struct BenchCase *c, int engine, double seconds){
+    char name[NAME_SIZE];
+    double ticks = 0, vehicles = 0;
+    unsigned long replication = 0;
+    double start = now(), elapsed;
+    do{
+        ReturnData res = runOneSimulation(c->arrivalRateLHS, c->lightPeriodLHS, c->arrivalRateRHS, c->lightPeriodRHS,
+                                          1, replication++, engine, VARIATES_PLAIN);
+        float clearance = res.clearanceTimeLHS > res.clearanceTimeRHS ? res.clearanceTimeLHS : res.clearanceTimeRHS;
+        ticks += ARRIVAL_ITERATIONS + 1 + clearance;
+        vehicles += res.numOfVehiclesLHS + res.numOfVehiclesRHS;
+        elapsed = now() - start;
+    }while(elapsed < seconds);
+
+    case_name(name, engine == ENGINE_EVENT ? "runOneSimulation/event" : "runOneSimulation/tick", c);
+    add_result(name, "ticks_per_sec", ticks / elapsed);
+    add_result(name, "vehicles_per_sec", vehicles / elapsed);
+}
+
+/**
+ * bench_run_simulations measures runSimulations on one case, in replications per second
+ * @param c - the case
+ * @param prefix - the name of the variant being measured
+ * @param options - the options to run with
+ * @param seconds - how long to keep calling runSimulations for
+ */
+static void bench_run_simulations(const struct BenchCase *c, const char *prefix, SimOptions *options, double seconds){
+    char name[NAME_SIZE];
+    double replications = 0;
+    double start = now(), elapsed;
+    do{
+        runSimulations(c->arrivalRateLHS, c->lightPeriodLHS, c->arrivalRateRHS, c->lightPeriodRHS, options, NULL, NULL);
+        replications += options->replications;
+        options->seed++;
+        elapsed = now() - start;
+    }while(elapsed < seconds);
+
+    case_name(name, prefix, c);
+    add_result(name, "replications_per_sec", replications / elapsed);
+}
+
+/**
+ * bench_helpers measures the cost of get_random_val, arrival_mask, add_node and remove_first_node on their own
+ * @param seconds - how long to run each of them for
+ */
+static void bench_helpers(double seconds){
+    SimRandom rng;
+    double calls = 0, start, elapsed, pushTime = 0, popTime = 0, pushed = 0;
+    float sum = 0;
+    uint64_t bits = 0;
+    uint64_t threshold = arrival_threshold(50);
+    int i;
+
+    /* draw random values in blocks so the clock is not read on every call */
+    sim_random_init(&rng, 1, 0);
+    start = now();
+    do{
+        for(i = 0; i < 1024; i++){
+            sum += get_random_val(&rng);
+        }
+        calls += 1024;
+        elapsed = now() - start;
+    }while(elapsed < seconds);
+    add_result("get_random_val", "calls_per_sec", calls / elapsed);
+
+    /* draw arrival masks the same way, counting each of the ARRIVAL_BLOCK arrival decisions of a mask */
+    calls = 0;
+    start = now();
+    do{
+        for(i = 0; i < 1024; i++){
+            bits ^= arrival_mask(&rng, threshold, VARIATES_PLAIN);
+        }
+        calls += 1024.0 * ARRIVAL_BLOCK;
+        elapsed = now() - start;
+    }while(elapsed < seconds);
+    add_result("arrival_mask", "decisions_per_sec", calls / elapsed);
+    sum += (float)(bits & 1);
+
+    /* fill a fresh queue (including its growth) and then empty it again, timing each half separately */
+    do{
+        struct Lights light;
+        double t0, t1;
+        init_lights(&light, 1, 1);
+        if(init_queue(&light) == 1){
+            break;
+        }
+        t0 = now();
+        for(i = 0; i < QUEUE_ROUND; i++){
+            add_node(&light, i);
+        }
+        t1 = now();
+        for(i = 0; i < QUEUE_ROUND; i++){
+            remove_first_node(&light, QUEUE_ROUND + i);
+        }
+        pushTime += t1 - t0;
+        popTime += now() - t1;
+        pushed += QUEUE_ROUND;
+        sum += light.avgTime;
+        free(light.queue);
+    }while(pushTime + popTime < seconds);
+    add_result("add_node", "calls_per_sec", pushed / pushTime);
+    add_result("remove_first_node", "calls_per_sec", pushed / popTime);
+
+    /* use the sum so the calls can't be optimised away */
+    if(sum < 0){
+        printf("%f\n", sum);
+    }
+}
+
+/**
+ * write_json writes every recorded result to a stream, one result per line
+ * @param out - the stream to write to
+ */
+static void write_json(FILE *out){
+    int i;
+    fprintf(out, "{\"benchmarks\": [\n");
+    for(i = 0; i < numResults; i++){
+        fprintf(out, "  {\"name\": \"%s\", \"metric\": \"%s\", \"value\": %.1f}%s\n",
+                results[i].name, results[i].metric, results[i].value, i + 1 < numResults ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+/**
+ * compare_baseline reads a baseline written by write_json and reports every result that is worse than it, or that
+ * this run did not measure
+ * @param path - the path of the baseline file
+ * @param tolerance - the fraction a result may drop by before it counts as a regression
+ * @return - the number of regressions and missing results found, or -1 if the baseline could not be read
+ */
+static int compare_baseline(const char *path, double tolerance){
+    FILE *in = fopen(path, "r");
+    char line[512];
+    int regressions = 0, i;
+    if(in == NULL){
+        return -1;
+    }
+    while(fgets(line, sizeof(line), in) != NULL){
+        char name[NAME_SIZE], metric[32];
+        double value;
+        int found = 0;
+        if(sscanf(line, " {\"name\": \"%127[^\"]\", \"metric\": \"%31[^\"]\", \"value\": %lf", name, metric, &value) != 3){
+            continue;
+        }
+        for(i = 0; i < numResults; i++){
+            if(strcmp(results[i].name, name) == 0 && strcmp(results[i].metric, metric) == 0){
+                double change = value > 0 ? results[i].value / value - 1 : 0;
+                if(change < -tolerance){
+                    fprintf(stderr, "REGRESSION %s %s: %.1f -> %.1f (%+.1f%%)\n",
+                            name, metric, value, results[i].value, change * 100);
+                    regressions++;
+                }else{
+                    fprintf(stderr, "ok %s %s: %+.1f%%\n", name, metric, change * 100);
+                }
+                found = 1;
+                break;
+            }
+        }
+        /* a result that is no longer measured counts against the run too, so that it can't be dropped unnoticed */
+        if(found == 0){
+            fprintf(stderr, "MISSING %s %s: in the baseline but not measured by this run\n", name, metric);
+            regressions++;
+        }
+    }
+    fclose(in);
+    return regressions;
+}
+
+/**
+ * Main function to run the benchmarks
+ * @param argc - number of arguements being passed in
+ * @param argv - array of parameters passed in by the user in the command line
+ * @return - EXIT_SUCCESS, or EXIT_FAILURE if a regression was found or the baseline could not be read
+ */
+int main(int argc, char *argv[]){
+    double seconds = 0.2;
+    double tolerance = 0.1;
+    const char *baseline = NULL;
+    int i;
+    for(i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--time") == 0 && i + 1 < argc){
+            seconds = atof(argv[++i]);
+        }else if(strcmp(argv[i], "--compare") == 0 && i + 1 < argc){
+            baseline = argv[++i];
+        }else if(strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc){
+            tolerance = atof(argv[++i]);
+        }else{
+            fprintf(stderr, "usage: %s [--time SECONDS] [--compare BASELINE] [--tolerance FRACTION]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bench_helpers(seconds);
+    for(i = 0; i < NUM_CASES; i++){
+        SimOptions options = {1, 1, ENGINE_TICK, BACKEND_SCALAR, NUM_REPLICATIONS, -1, 0};
+        bench_one_simulation(&CASES[i], ENGINE_TICK, seconds);
+        bench_one_simulation(&CASES[i], ENGINE_EVENT, seconds);
+        bench_run_simulations(&CASES[i], "runSimulations/scalar", &options, seconds);
+        options.backend = BACKEND_SIMD;
+        bench_run_simulations(&CASES[i], "runSimulations/simd", &options, seconds);
+        options.backend = BACKEND_SCALAR;
+        options.threads = get_num_cores();
+        bench_run_simulations(&CASES[i], "runSimulations/threads", &options, seconds);
+    }
+    write_json(stdout);
+
+    if(baseline != NULL){
+        int regressions = compare_baseline(baseline, tolerance);
+        if(regressions < 0){
+            fprintf(stderr, "could not read baseline %s\n", baseline);
+            return EXIT_FAILURE;
+        }
+        if(regressions > 0){
+            fprintf(stderr, "%d regressions or missing results against %s\n", regressions, baseline);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
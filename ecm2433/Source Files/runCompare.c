@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "runCompare.h"
+
+/*
+ * runCompare compares two configurations with common random numbers: replication i of both configurations is driven
+ * by the same synced arrival stream, so most of the noise is shared and cancels out of the difference between them.
+ * With VARIATES_ANTITHETIC each replication also has an antithetic twin on the same stream, and the difference of a
+ * replication is the mean of the differences of the twins.
+ * The variance reduction reported for each field is how many times fewer replications the comparison needs than
+ * independently seeded runs of the two configurations would, for the same confidence interval on the difference.
+*/
+
+/*
+ * CompareJob is the state shared by the workers while the comparison is run
+ * Task i of the pool runs replication i of both configurations, and its twins, storing them in
+ * results[(i * 2 + config) * twins + twin]
+*/
+struct CompareJob {
+    SimConfig *configs[2];
+    SimOptions *options;
+    int variates;
+    int twins;
+    ReturnData *results;
+};
+
+/**
+ * run_compare_task is the worker pool task that runs one replication of both configurations
+ * @param index - the replication to run
+ * @param arg - pointer to the CompareJob being run
+ */
+static void run_compare_task(long index, void *arg){
+    struct CompareJob *job = (struct CompareJob*) arg;
+    ReturnData *results = job->results + index * 2 * job->twins;
+    int config, twin;
+    for(config = 0; config < 2; config++){
+        SimConfig *c = job->configs[config];
+        for(twin = 0; twin < job->twins; twin++){
+            /* the second twin mirrors the first */
+            int variates = twin == 0 ? job->variates & ~VARIATES_ANTITHETIC : job->variates;
+            results[config * job->twins + twin] = runOneSimulation(c->arrivalRateLHS, c->lightPeriodLHS,
+                                                                   c->arrivalRateRHS, c->lightPeriodRHS,
+                                                                   job->options->seed, index, ENGINE_TICK, variates);
+        }
+    }
+}
+
+/**
+ * runCompare runs options->replications paired replications of two configurations, see the top of this file, and
+ * writes a CSV row per ReturnData field with the mean of each configuration, their difference with its 95% confidence
+ * interval half width, and the variance reduction achieved
+ * @param first - the first configuration
+ * @param second - the second configuration, the difference is first - second
+ * @param variates - VARIATES_SYNCED, with VARIATES_ANTITHETIC to add an antithetic twin to each replication
+ * @param options - the seed, number of threads and replications to use
+ * @param out - the stream to write the CSV rows to
+ * @return - an integer to state whether the comparison was successful(0) or not(1)
+ */
+int runCompare(SimConfig *first, SimConfig *second, int variates, SimOptions *options, FILE *out){
+    struct CompareJob job = {{first, second}, options, variates | VARIATES_SYNCED,
+                             variates & VARIATES_ANTITHETIC ? 2 : 1, NULL};
+    RunningStat statsFirst[NUM_METRICS], statsSecond[NUM_METRICS], difference[NUM_METRICS];
+    long replication;
+    int metric, twin;
+
+    /* malloc the space for the results of every replication and its twin, of both configurations */
+    job.results = (ReturnData*) malloc(sizeof(ReturnData) * 2 * job.twins * options->replications);
+    if(job.results == NULL){
+        return 1;
+    }
+    run_pool(options->replications, options->threads, run_compare_task, &job);
+
+    /* fold the replications in order, skipping any where either configuration failed */
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        stat_init(&statsFirst[metric]);
+        stat_init(&statsSecond[metric]);
+        stat_init(&difference[metric]);
+    }
+    for(replication = 0; replication < options->replications; replication++){
+        ReturnData *results = job.results + replication * 2 * job.twins;
+        int failed = 0;
+        for(twin = 0; twin < 2 * job.twins; twin++){
+            failed |= results[twin].status == 0;
+        }
+        if(failed){
+            continue;
+        }
+        for(metric = 0; metric < NUM_METRICS; metric++){
+            double diff = 0;
+            for(twin = 0; twin < job.twins; twin++){
+                double a = get_metric(results[twin], metric);
+                double b = get_metric(results[job.twins + twin], metric);
+                stat_add(&statsFirst[metric], a);
+                stat_add(&statsSecond[metric], b);
+                diff += a - b;
+            }
+            stat_add(&difference[metric], diff / job.twins);
+        }
+    }
+
+    fprintf(out, "metric,first,second,difference,differenceHalfWidth,varianceReduction\n");
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        /* independent runs of both configurations would give the difference a variance of var(first) + var(second)
+         * per replication, while each paired difference here cost twins replications of each */
+        double independent = stat_variance(&statsFirst[metric]) + stat_variance(&statsSecond[metric]);
+        double paired = stat_variance(&difference[metric]) * job.twins;
+        fprintf(out, "%s,%f,%f,%f,%f,%f\n",
+                metric_name(metric),
+                statsFirst[metric].mean,
+                statsSecond[metric].mean,
+                difference[metric].mean,
+                stat_half_width(&difference[metric]),
+                paired > 0 ? independent / paired : HUGE_VAL);
+    }
+    fprintf(out, "# %ld paired replications%s\n", difference[0].count,
+            job.twins == 2 ? ", each with an antithetic twin" : "");
+
+    free(job.results);
+    return 0;
+}
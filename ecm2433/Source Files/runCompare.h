@@ -0,0 +1,11 @@
+#ifndef ECM2433___CW_RUNCOMPARE_H
+#define ECM2433___CW_RUNCOMPARE_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimConfig and SimOptions structs */
+#include "runSimulations.h"
+
+/* Declare the functions of runCompare.c */
+int runCompare(SimConfig *first, SimConfig *second, int variates, SimOptions *options, FILE *out);
+
+#endif
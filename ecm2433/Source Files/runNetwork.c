@@ -0,0 +1,827 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "runNetwork.h"
+
+/*
+ * runNetwork simulates a network of signalled intersections, described by a topology file with one item per line:
+ *     intersection NAME
+ *     approach NAME INTERSECTION ARRIVAL_RATE
+ *     phase INTERSECTION PERIOD APPROACH [APPROACH...]
+ *     link FROM_APPROACH TO_APPROACH PERCENT
+ * Each approach is a queue like a light of runOneSimulation, with vehicles arriving from outside the network at
+ * ARRIVAL_RATE. An intersection cycles through its phases in the order given, each phase keeps its approaches green
+ * for PERIOD iterations, followed by one iteration where the lights change and nothing moves, exactly like
+ * update_light. A vehicle leaving an approach moves on to the approach of one of its links, chosen with the link's
+ * PERCENT chance (whatever is left over leaves the network), and joins that queue on the next iteration.
+ * Names must be unique, periods at least 1 and the links out of an approach must add up to at most 100 percent. Every
+ * approach that vehicles can reach must be in a phase and have a route out of the network (see check_network).
+ * The original junction is one intersection with a phase for the right light followed by a phase for the left light.
+ *
+ * The intersections are split into one contiguous block per thread. Vehicles moving between approaches are passed
+ * through hand-off buffers that are delivered between iterations, in order of the approach they came from, and each
+ * approach draws from its own random stream, so the results do not depend on the number of threads.
+*/
+
+/*
+ * NetLink is a route out of an approach
+*/
+struct NetLink {
+    int to;
+    int percent;
+};
+
+/*
+ * NetApproach is one queue of the network, its light holds the queue and the statistics of the approach, and a
+ * vehicle arrives from outside the network when a word of its stream is below threshold (see arrival_threshold)
+*/
+struct NetApproach {
+    char name[NETWORK_NAME_LENGTH];
+    int intersection;
+    int arrivalRate;
+    uint64_t threshold;
+    struct Lights light;
+    SimRandom rng;
+    int firstLink;
+    int numLinks;
+};
+
+/*
+ * NetPhase is one phase of an intersection's plan, the approaches it makes green are
+ * phaseApproaches[first] to phaseApproaches[first + count - 1]
+*/
+struct NetPhase {
+    int period;
+    int first;
+    int count;
+};
+
+/*
+ * NetIntersection is a signalled intersection, its phases are phases[firstPhase] onwards, in plan order
+ * int phase - the index of the current phase within the intersection
+ * int timer - the iterations left of the current phase, the lights change when it reaches 0
+*/
+struct NetIntersection {
+    char name[NETWORK_NAME_LENGTH];
+    int firstPhase;
+    int numPhases;
+    int phase;
+    int timer;
+    int firstApproach;
+    int numApproaches;
+};
+
+/*
+ * Network holds a whole parsed topology, approaches are grouped by intersection so that each intersection's approaches
+ * are approaches[firstApproach] onwards
+*/
+struct Network {
+    struct NetIntersection *intersections;
+    int numIntersections;
+    struct NetApproach *approaches;
+    int numApproaches;
+    struct NetPhase *phases;
+    int numPhases;
+    int *phaseApproaches;
+    int numPhaseApproaches;
+    struct NetLink *links;
+    int numLinks;
+};
+
+/*
+ * HandOff is a growable buffer of the approaches that vehicles are moving to
+*/
+struct HandOff {
+    int *to;
+    int length;
+    int capacity;
+};
+
+/*
+ * NetRun is the state shared by the threads of one replication
+ * struct HandOff *boxes - numThreads * numThreads buffers, box [from * numThreads + to] carries vehicles from the block
+ *                         of thread from to the block of thread to
+ * int *owner - the thread that owns each approach
+ * long *waiting - the number of vehicles waiting in each thread's block
+ * int *failed - 1 for each thread whose block has failed to malloc the space for a vehicle, published with waiting so
+ *               that every thread reads the same flags after the second barrier of an iteration
+ * int start - 0 until every thread has been created, then 1 to start the replication or -1 to abandon it
+ * int unfinished - 1 if the replication was stopped as its queues had not cleared after NETWORK_MAX_CLEARANCE iterations
+*/
+struct NetRun {
+    struct Network *net;
+    int numThreads;
+    int max;
+    struct HandOff *boxes;
+    int *owner;
+    long *waiting;
+    int *failed;
+    int start;
+    int unfinished;
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    pthread_barrier_t barrier;
+};
+
+/*
+ * NetWorker is the argument handed to each thread, its block is intersections first to last - 1
+ * int failed - 1 once the block has failed to malloc the space for a vehicle, only written by this worker's thread
+*/
+struct NetWorker {
+    struct NetRun *run;
+    int id;
+    int first;
+    int last;
+    int failed;
+};
+
+/**
+ * find_intersection looks up an intersection by its name
+ * @param net - the network read so far
+ * @param name - the name to look for
+ * @return - the index of the intersection, or -1 if there is none with that name
+ */
+static int find_intersection(struct Network *net, const char *name){
+    int i;
+    for(i = 0; i < net->numIntersections; i++){
+        if(strcmp(net->intersections[i].name, name) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * find_approach looks up an approach by its name
+ * @param approaches - the approaches read so far
+ * @param count - the number of approaches read so far
+ * @param name - the name to look for
+ * @return - the index of the approach, or -1 if there is none with that name
+ */
+static int find_approach(struct NetApproach *approaches, int count, const char *name){
+    int i;
+    for(i = 0; i < count; i++){
+        if(strcmp(approaches[i].name, name) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * grow_array makes sure an array has space for one more item, doubling it when it is full
+ * @param array - pointer to the array pointer
+ * @param capacity - pointer to the number of items the array has space for
+ * @param count - the number of items in the array
+ * @param size - the size of each item
+ * @return - an integer to state whether this was successful(0) or not(1)
+ */
+static int grow_array(void **array, int *capacity, int count, size_t size){
+    if(count < *capacity){
+        return 0;
+    }
+    int newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+    void *tmp = realloc(*array, size * newCapacity);
+    if(tmp == NULL){
+        return 1;
+    }
+    *array = tmp;
+    *capacity = newCapacity;
+    return 0;
+}
+
+/**
+ * free_network frees the memory of a network
+ * @param net - pointer to the network
+ */
+static void free_network(struct Network *net){
+    int i;
+    for(i = 0; net->approaches != NULL && i < net->numApproaches; i++){
+        free(net->approaches[i].light.queue);
+    }
+    free(net->intersections);
+    free(net->approaches);
+    free(net->phases);
+    free(net->phaseApproaches);
+    free(net->links);
+}
+
+/*
+ * RawPhase and RawLink hold phases and links by name while the topology file is read, before they are grouped
+*/
+struct RawPhase {
+    int intersection;
+    int period;
+    int first;
+    int count;
+};
+struct RawLink {
+    int from;
+    int to;
+    int percent;
+};
+
+/**
+ * check_network makes sure that every vehicle of a network can leave it, as a replication only finishes once every
+ * queue is empty: each approach that vehicles can get into must be green in some phase, and must have a route out of
+ * the network, which rules out links that send every vehicle round a loop
+ * @param net - the network, with its approaches, phases and links grouped
+ * @return - an integer to state whether the network was valid(0) or not(1), with the reason written to stderr
+ */
+static int check_network(struct Network *net){
+    int *green = (int*) calloc((size_t)net->numApproaches + 1, sizeof(int));
+    int *entered = (int*) calloc((size_t)net->numApproaches + 1, sizeof(int));
+    int *leaves = (int*) calloc((size_t)net->numApproaches + 1, sizeof(int));
+    int invalid = green == NULL || entered == NULL || leaves == NULL;
+    int changed = 1;
+    int i, k;
+
+    for(i = 0; i < net->numPhaseApproaches && invalid == 0; i++){
+        green[net->phaseApproaches[i]] = 1;
+    }
+    for(i = 0; i < net->numApproaches && invalid == 0; i++){
+        struct NetApproach *a = &net->approaches[i];
+        int total = 0;
+        entered[i] |= a->threshold > 0;
+        for(k = a->firstLink; k < a->firstLink + a->numLinks; k++){
+            total += net->links[k].percent;
+            entered[net->links[k].to] |= net->links[k].percent > 0;
+        }
+        if(total > 100){
+            fprintf(stderr, "the links out of approach %s add up to more than 100 percent\n", a->name);
+            invalid = 1;
+        }
+        /* whatever the links leave over leaves the network */
+        leaves[i] = total < 100;
+    }
+
+    /* an approach has a route out if any of its links leads to an approach that has one */
+    while(changed && invalid == 0){
+        changed = 0;
+        for(i = 0; i < net->numApproaches; i++){
+            struct NetApproach *a = &net->approaches[i];
+            for(k = a->firstLink; leaves[i] == 0 && k < a->firstLink + a->numLinks; k++){
+                if(net->links[k].percent > 0 && leaves[net->links[k].to]){
+                    leaves[i] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    for(i = 0; i < net->numApproaches && invalid == 0; i++){
+        struct NetApproach *a = &net->approaches[i];
+        if(entered[i] && green[i] == 0){
+            fprintf(stderr, "approach %s gets vehicles but is not in any phase of %s, so they could never leave\n",
+                    a->name, net->intersections[a->intersection].name);
+            invalid = 1;
+        }else if(entered[i] && leaves[i] == 0){
+            fprintf(stderr, "vehicles that reach approach %s are linked round a loop and can never leave the network\n",
+                    a->name);
+            invalid = 1;
+        }
+    }
+    free(green);
+    free(entered);
+    free(leaves);
+    return invalid;
+}
+
+/**
+ * load_network reads a topology file, see the top of this file for the format
+ * @param in - the stream to read from
+ * @param net - the network to fill in
+ * @return - an integer to state whether the file was valid(0) or not(1)
+ */
+static int load_network(FILE *in, struct Network *net){
+    char line[1024];
+    int lineNo = 0, i, j;
+    int capIntersections = 0, capApproaches = 0, capPhases = 0, capPhaseApproaches = 0, capLinks = 0;
+    struct RawPhase *rawPhases = NULL;
+    struct RawLink *rawLinks = NULL;
+    int numRawPhases = 0, numRawLinks = 0;
+    struct NetApproach *rawApproaches = NULL;
+    int *phaseNames = NULL;
+    int numPhaseNames = 0;
+
+    memset(net, 0, sizeof(*net));
+    while(fgets(line, sizeof(line), in) != NULL){
+        char *kind = strtok(line, " \t\r\n");
+        char *field;
+        lineNo++;
+        if(kind == NULL || kind[0] == '#'){
+            continue;
+        }
+        if(strcmp(kind, "intersection") == 0){
+            field = strtok(NULL, " \t\r\n");
+            if(field == NULL || find_intersection(net, field) >= 0
+                             || grow_array((void**)&net->intersections, &capIntersections, net->numIntersections,
+                                           sizeof(struct NetIntersection))){
+                goto invalid;
+            }
+            struct NetIntersection *x = &net->intersections[net->numIntersections++];
+            memset(x, 0, sizeof(*x));
+            strncpy(x->name, field, NETWORK_NAME_LENGTH - 1);
+        }else if(strcmp(kind, "approach") == 0){
+            char *name = strtok(NULL, " \t\r\n");
+            char *where = strtok(NULL, " \t\r\n");
+            char *rate = strtok(NULL, " \t\r\n");
+            if(rate == NULL || find_approach(rawApproaches, net->numApproaches, name) >= 0
+                            || grow_array((void**)&rawApproaches, &capApproaches, net->numApproaches,
+                                          sizeof(struct NetApproach))){
+                goto invalid;
+            }
+            struct NetApproach *a = &rawApproaches[net->numApproaches];
+            memset(a, 0, sizeof(*a));
+            strncpy(a->name, name, NETWORK_NAME_LENGTH - 1);
+            a->intersection = find_intersection(net, where);
+            a->arrivalRate = atoi(rate);
+            a->threshold = arrival_threshold(a->arrivalRate);
+            if(a->intersection < 0){
+                goto invalid;
+            }
+            net->numApproaches++;
+        }else if(strcmp(kind, "phase") == 0){
+            char *where = strtok(NULL, " \t\r\n");
+            char *period = strtok(NULL, " \t\r\n");
+            if(period == NULL || grow_array((void**)&rawPhases, &capPhases, numRawPhases, sizeof(struct RawPhase))){
+                goto invalid;
+            }
+            struct RawPhase *p = &rawPhases[numRawPhases++];
+            p->intersection = find_intersection(net, where);
+            p->period = atoi(period);
+            p->first = numPhaseNames;
+            p->count = 0;
+            /* a phase must last at least one iteration, or its approaches would never be let through */
+            if(p->intersection < 0 || p->period < 1){
+                goto invalid;
+            }
+            while((field = strtok(NULL, " \t\r\n")) != NULL){
+                int a = find_approach(rawApproaches, net->numApproaches, field);
+                if(a < 0 || rawApproaches[a].intersection != p->intersection
+                         || grow_array((void**)&phaseNames, &capPhaseApproaches, numPhaseNames, sizeof(int))){
+                    goto invalid;
+                }
+                phaseNames[numPhaseNames++] = a;
+                p->count++;
+            }
+        }else if(strcmp(kind, "link") == 0){
+            char *from = strtok(NULL, " \t\r\n");
+            char *to = strtok(NULL, " \t\r\n");
+            char *percent = strtok(NULL, " \t\r\n");
+            if(percent == NULL || grow_array((void**)&rawLinks, &capLinks, numRawLinks, sizeof(struct RawLink))){
+                goto invalid;
+            }
+            struct RawLink *l = &rawLinks[numRawLinks++];
+            l->from = find_approach(rawApproaches, net->numApproaches, from);
+            l->to = find_approach(rawApproaches, net->numApproaches, to);
+            l->percent = atoi(percent);
+            if(l->from < 0 || l->to < 0 || l->percent < 0 || l->percent > 100){
+                goto invalid;
+            }
+        }else{
+            goto invalid;
+        }
+    }
+    if(net->numIntersections == 0){
+        fprintf(stderr, "the network has no intersections\n");
+        goto failed;
+    }
+
+    /* group the approaches by intersection, remembering where each one moved to */
+    int *moved = (int*) malloc(sizeof(int) * (net->numApproaches + 1));
+    net->approaches = (struct NetApproach*) malloc(sizeof(struct NetApproach) * (net->numApproaches + 1));
+    net->phases = (struct NetPhase*) malloc(sizeof(struct NetPhase) * (numRawPhases + 1));
+    net->phaseApproaches = (int*) malloc(sizeof(int) * (numPhaseNames + 1));
+    net->links = (struct NetLink*) malloc(sizeof(struct NetLink) * (numRawLinks + 1));
+    if(moved == NULL || net->approaches == NULL || net->phases == NULL || net->phaseApproaches == NULL
+                     || net->links == NULL){
+        free(moved);
+        goto failed;
+    }
+    int count = 0;
+    for(i = 0; i < net->numIntersections; i++){
+        struct NetIntersection *x = &net->intersections[i];
+        x->firstApproach = count;
+        for(j = 0; j < net->numApproaches; j++){
+            if(rawApproaches[j].intersection == i){
+                moved[j] = count;
+                net->approaches[count++] = rawApproaches[j];
+            }
+        }
+        x->numApproaches = count - x->firstApproach;
+    }
+
+    /* group the phases by intersection, keeping their plan order */
+    count = 0;
+    for(i = 0; i < net->numIntersections; i++){
+        struct NetIntersection *x = &net->intersections[i];
+        x->firstPhase = count;
+        for(j = 0; j < numRawPhases; j++){
+            if(rawPhases[j].intersection == i){
+                struct NetPhase *p = &net->phases[count++];
+                int k;
+                p->period = rawPhases[j].period;
+                p->first = net->numPhaseApproaches;
+                p->count = rawPhases[j].count;
+                for(k = 0; k < p->count; k++){
+                    net->phaseApproaches[net->numPhaseApproaches++] = moved[phaseNames[rawPhases[j].first + k]];
+                }
+            }
+        }
+        x->numPhases = count - x->firstPhase;
+    }
+    net->numPhases = count;
+
+    /* group the links by the approach they leave */
+    count = 0;
+    for(i = 0; i < net->numApproaches; i++){
+        struct NetApproach *a = &net->approaches[i];
+        a->firstLink = count;
+        for(j = 0; j < numRawLinks; j++){
+            if(moved[rawLinks[j].from] == i){
+                net->links[count].to = moved[rawLinks[j].to];
+                net->links[count].percent = rawLinks[j].percent;
+                count++;
+            }
+        }
+        a->numLinks = count - a->firstLink;
+    }
+    net->numLinks = count;
+
+    free(moved);
+    free(rawApproaches);
+    free(rawPhases);
+    free(rawLinks);
+    free(phaseNames);
+    if(check_network(net) == 1){
+        free_network(net);
+        return 1;
+    }
+    return 0;
+
+invalid:
+    fprintf(stderr, "topology line %d is not valid\n", lineNo);
+failed:
+    /* no queues have been made yet, so only the arrays need freeing */
+    net->numApproaches = 0;
+    free(rawApproaches);
+    free(rawPhases);
+    free(rawLinks);
+    free(phaseNames);
+    free_network(net);
+    return 1;
+}
+
+/**
+ * hand_off adds a vehicle to a hand-off buffer
+ * @param box - the buffer
+ * @param to - the approach the vehicle is moving to
+ * @return - an integer to state whether this was successful(0) or not(1)
+ */
+static int hand_off(struct HandOff *box, int to){
+    if(grow_array((void**)&box->to, &box->capacity, box->length, sizeof(int))){
+        return 1;
+    }
+    box->to[box->length++] = to;
+    return 0;
+}
+
+/**
+ * run_block runs one iteration of the intersections of a worker's block
+ * @param worker - the worker
+ * @param iteration - the iteration being run
+ */
+static void run_block(struct NetWorker *worker, int iteration){
+    struct NetRun *run = worker->run;
+    struct Network *net = run->net;
+    int i, j;
+    for(i = worker->first; i < worker->last; i++){
+        struct NetIntersection *x = &net->intersections[i];
+
+        /* count this iteration towards the clearance time of every approach with vehicles still waiting */
+        if(iteration > run->max){
+            for(j = x->firstApproach; j < x->firstApproach + x->numApproaches; j++){
+                net->approaches[j].light.clearanceTime += is_empty(&net->approaches[j].light) == 0;
+            }
+        }
+
+        /* update the lights, when the phase's timer runs out this iteration only changes the lights */
+        if(x->numPhases == 0){
+            continue;
+        }
+        if(x->timer == 0){
+            x->phase = (x->phase + 1) % x->numPhases;
+            x->timer = net->phases[x->firstPhase + x->phase].period;
+            continue;
+        }
+        x->timer--;
+
+        /* vehicles arrive from outside the network using the same integer threshold as the tick engine, an approach
+         * with an arrival rate of 0 only takes vehicles from its links */
+        if(iteration < run->max){
+            for(j = x->firstApproach; j < x->firstApproach + x->numApproaches; j++){
+                struct NetApproach *a = &net->approaches[j];
+                if(a->threshold > 0 && sim_random_next(&a->rng) < a->threshold && add_node(&a->light, iteration)){
+                    worker->failed = 1;
+                }
+            }
+        }
+
+        /* every green approach lets one vehicle through, which moves on along one of its links */
+        struct NetPhase *p = &net->phases[x->firstPhase + x->phase];
+        for(j = p->first; j < p->first + p->count; j++){
+            struct NetApproach *a = &net->approaches[net->phaseApproaches[j]];
+            if(remove_first_node(&a->light, iteration) == 0 && a->numLinks > 0){
+                int roll = (int) get_random_val(&a->rng);
+                int k;
+                for(k = a->firstLink; k < a->firstLink + a->numLinks; k++){
+                    roll -= net->links[k].percent;
+                    if(roll < 0){
+                        int to = net->links[k].to;
+                        if(hand_off(&run->boxes[worker->id * run->numThreads + run->owner[to]], to)){
+                            worker->failed = 1;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * deliver moves the vehicles handed off to a worker's block into their queues, in order of the block they came from,
+ * and publishes how many vehicles are waiting in the block and whether it has failed
+ * @param worker - the worker
+ * @param iteration - the iteration the vehicles join their queues in
+ */
+static void deliver(struct NetWorker *worker, int iteration){
+    struct NetRun *run = worker->run;
+    struct Network *net = run->net;
+    long waiting = 0;
+    int from, i;
+    for(from = 0; from < run->numThreads; from++){
+        struct HandOff *box = &run->boxes[from * run->numThreads + worker->id];
+        for(i = 0; i < box->length; i++){
+            if(add_node(&net->approaches[box->to[i]].light, iteration)){
+                worker->failed = 1;
+            }
+        }
+        box->length = 0;
+    }
+    for(i = net->intersections[worker->first].firstApproach;
+        worker->last > worker->first && i < net->intersections[worker->last - 1].firstApproach
+                                          + net->intersections[worker->last - 1].numApproaches; i++){
+        waiting += net->approaches[i].light.length;
+    }
+    run->waiting[worker->id] = waiting;
+    run->failed[worker->id] = worker->failed;
+}
+
+/**
+ * network_worker is the body of every thread, it runs its block one iteration at a time in step with the others
+ * @param data - pointer to the NetWorker struct for this thread
+ * @return - always NULL
+ */
+static void *network_worker(void *data){
+    struct NetWorker *worker = (struct NetWorker*) data;
+    struct NetRun *run = worker->run;
+    int iteration = 0;
+    int t;
+    while(1){
+        run_block(worker, iteration);
+        pthread_barrier_wait(&run->barrier);
+        deliver(worker, iteration + 1);
+        pthread_barrier_wait(&run->barrier);
+
+        /* stop every thread together once any block has failed, the flags only change between the barriers */
+        int failed = 0;
+        for(t = 0; t < run->numThreads; t++){
+            failed |= run->failed[t];
+        }
+        if(failed){
+            break;
+        }
+
+        /* once vehicles have stopped arriving, finish when every queue is empty */
+        iteration++;
+        if(iteration > run->max){
+            long waiting = 0;
+            for(t = 0; t < run->numThreads; t++){
+                waiting += run->waiting[t];
+            }
+            if(waiting == 0){
+                break;
+            }
+            /* every thread reaches the cap on the same iteration, so they all stop together */
+            if(iteration > run->max + NETWORK_MAX_CLEARANCE){
+                if(worker->id == 0){
+                    run->unfinished = 1;
+                }
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * reset_network empties every queue and resets the lights and random streams for a replication
+ * @param net - the network
+ * @param seed - the master seed
+ * @param replication - the replication number
+ * @return - an integer to state whether this was successful(0) or not(1)
+ */
+static int reset_network(struct Network *net, unsigned long seed, unsigned long replication){
+    int i;
+    for(i = 0; i < net->numIntersections; i++){
+        struct NetIntersection *x = &net->intersections[i];
+        x->phase = 0;
+        x->timer = x->numPhases > 0 ? net->phases[x->firstPhase].period : 0;
+    }
+    for(i = 0; i < net->numApproaches; i++){
+        struct NetApproach *a = &net->approaches[i];
+        free(a->light.queue);
+        init_lights(&a->light, 0, 0);
+        if(init_queue(&a->light) == 1){
+            return 1;
+        }
+        /* every approach of every replication gets its own stream */
+        sim_random_init(&a->rng, seed, ((unsigned long)replication << 32) + i);
+    }
+    return 0;
+}
+
+/**
+ * network_thread is the start routine of the extra threads, it waits until every thread has been created before
+ * joining in, as the barrier needs all of them
+ * @param data - pointer to the NetWorker struct for this thread
+ * @return - always NULL
+ */
+static void *network_thread(void *data){
+    struct NetRun *run = ((struct NetWorker*) data)->run;
+    pthread_mutex_lock(&run->lock);
+    while(run->start == 0){
+        pthread_cond_wait(&run->started, &run->lock);
+    }
+    pthread_mutex_unlock(&run->lock);
+    if(run->start == 1){
+        network_worker(data);
+    }
+    return NULL;
+}
+
+/**
+ * run_replication_network runs one replication of the network over numThreads threads
+ * @param run - the run state, with the network and hand-off buffers set up
+ * @param workers - one NetWorker per thread
+ * @return - an integer to state whether this was successful(0) or not(1), including when it did not clear
+ */
+static int run_replication_network(struct NetRun *run, struct NetWorker *workers){
+    pthread_t *threads = (pthread_t*) malloc(sizeof(pthread_t) * run->numThreads);
+    int i, created = 1, failed = 0;
+    if(threads == NULL){
+        return 1;
+    }
+    for(i = 0; i < run->numThreads; i++){
+        workers[i].failed = 0;
+    }
+    run->start = 0;
+    run->unfinished = 0;
+    pthread_mutex_init(&run->lock, NULL);
+    pthread_cond_init(&run->started, NULL);
+    pthread_barrier_init(&run->barrier, NULL, run->numThreads);
+    for(i = 1; i < run->numThreads; i++){
+        if(pthread_create(&threads[i], NULL, network_thread, &workers[i]) != 0){
+            break;
+        }
+        created++;
+    }
+
+    /* start the threads, or send them home if any could not be created */
+    pthread_mutex_lock(&run->lock);
+    run->start = created == run->numThreads ? 1 : -1;
+    pthread_cond_broadcast(&run->started);
+    pthread_mutex_unlock(&run->lock);
+    if(run->start == 1){
+        network_worker(&workers[0]);
+    }else{
+        failed = 1;
+    }
+    for(i = 1; i < created; i++){
+        pthread_join(threads[i], NULL);
+    }
+    for(i = 0; i < run->numThreads; i++){
+        failed |= workers[i].failed;
+    }
+    pthread_barrier_destroy(&run->barrier);
+    pthread_cond_destroy(&run->started);
+    pthread_mutex_destroy(&run->lock);
+    free(threads);
+    return failed || run->unfinished;
+}
+
+/**
+ * runNetwork reads a topology, simulates it options->replications times and writes the statistics of every approach
+ * as CSV rows (the means over the replications of the ReturnData fields of the approach)
+ * @param in - the stream to read the topology from
+ * @param out - the stream to write the CSV rows to
+ * @param options - the seed, number of threads and replications to use
+ * @return - an integer to state whether the simulation was successful(0) or not(1)
+ */
+int runNetwork(FILE *in, FILE *out, SimOptions *options){
+    struct Network net;
+    struct NetRun run;
+    int i;
+    long replication;
+    if(load_network(in, &net) == 1){
+        return 1;
+    }
+
+    /* split the intersections into one block per thread */
+    run.net = &net;
+    run.numThreads = options->threads < net.numIntersections ? options->threads : net.numIntersections;
+    if(run.numThreads < 1){
+        run.numThreads = 1;
+    }
+    run.max = ARRIVAL_ITERATIONS;
+    run.unfinished = 0;
+    run.boxes = (struct HandOff*) calloc((size_t)run.numThreads * run.numThreads, sizeof(struct HandOff));
+    run.owner = (int*) malloc(sizeof(int) * (net.numApproaches + 1));
+    run.waiting = (long*) malloc(sizeof(long) * run.numThreads);
+    run.failed = (int*) malloc(sizeof(int) * run.numThreads);
+    struct NetWorker *workers = (struct NetWorker*) malloc(sizeof(struct NetWorker) * run.numThreads);
+    /* accumulators for the numOfVehicles, avgTime, maxTime and clearanceTime of every approach */
+    RunningStat *stats = (RunningStat*) malloc(sizeof(RunningStat) * 4 * (net.numApproaches + 1));
+    int failed = run.boxes == NULL || run.owner == NULL || run.waiting == NULL || run.failed == NULL
+                 || workers == NULL || stats == NULL;
+    if(failed == 0){
+        for(i = 0; i < run.numThreads; i++){
+            int j;
+            workers[i].run = &run;
+            workers[i].id = i;
+            workers[i].first = (int)((long)net.numIntersections * i / run.numThreads);
+            workers[i].last = (int)((long)net.numIntersections * (i + 1) / run.numThreads);
+            for(j = workers[i].first; j < workers[i].last; j++){
+                int k;
+                for(k = 0; k < net.intersections[j].numApproaches; k++){
+                    run.owner[net.intersections[j].firstApproach + k] = i;
+                }
+            }
+        }
+        for(i = 0; i < 4 * net.numApproaches; i++){
+            stat_init(&stats[i]);
+        }
+    }
+
+    /* run each replication, adding every approach's results to its accumulators */
+    for(replication = 0; failed == 0 && replication < options->replications; replication++){
+        if(reset_network(&net, options->seed, replication) == 1 || run_replication_network(&run, workers) == 1){
+            if(run.unfinished){
+                fprintf(stderr, "replication %ld still had vehicles waiting %d iterations after arrivals stopped\n",
+                        replication, NETWORK_MAX_CLEARANCE);
+            }
+            failed = 1;
+            break;
+        }
+        for(i = 0; i < net.numApproaches; i++){
+            struct Lights *light = &net.approaches[i].light;
+            stat_add(&stats[4 * i], light->numOfVehicles);
+            stat_add(&stats[4 * i + 1], light->avgTime);
+            stat_add(&stats[4 * i + 2], light->maxTime);
+            stat_add(&stats[4 * i + 3], light->clearanceTime);
+        }
+    }
+
+    if(failed == 0){
+        fprintf(out, "approach,intersection,numOfVehicles,avgTime,avgTimeHalfWidth,maxTime,clearanceTime\n");
+        for(i = 0; i < net.numApproaches; i++){
+            fprintf(out, "%s,%s,%f,%f,%f,%f,%f\n",
+                    net.approaches[i].name,
+                    net.intersections[net.approaches[i].intersection].name,
+                    stats[4 * i].mean,
+                    stats[4 * i + 1].mean,
+                    stat_half_width(&stats[4 * i + 1]),
+                    stats[4 * i + 2].mean,
+                    stats[4 * i + 3].mean);
+        }
+    }
+
+    /* free the memory used by the run */
+    if(run.boxes != NULL){
+        for(i = 0; i < run.numThreads * run.numThreads; i++){
+            free(run.boxes[i].to);
+        }
+    }
+    free(run.boxes);
+    free(run.owner);
+    free(run.waiting);
+    free(run.failed);
+    free(workers);
+    free(stats);
+    free_network(&net);
+    return failed;
+}
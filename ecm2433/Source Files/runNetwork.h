@@ -0,0 +1,18 @@
+#ifndef ECM2433___CW_RUNNETWORK_H
+#define ECM2433___CW_RUNNETWORK_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimOptions struct */
+#include "runSimulations.h"
+
+/* The longest name of an intersection or approach in a topology file */
+#define NETWORK_NAME_LENGTH 32
+
+/* The most iterations a replication may run for after arrivals stop, it is abandoned with an error if its queues have
+ * not cleared by then */
+#define NETWORK_MAX_CLEARANCE 1000000
+
+/* Declare the functions of runNetwork.c */
+int runNetwork(FILE *in, FILE *out, SimOptions *options);
+
+#endif
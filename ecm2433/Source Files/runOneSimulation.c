@@ -1,158 +1,158 @@
 #include <stdio.h>
 #include "runOneSimulation.h"
-#include <sys/time.h>
+#include "simCounters.h"
+#include "simTrace.h"
+#include "simHistogram.h"
 #include <stdlib.h>
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
-
-/*
- * Vehicle is a struct that represents a vehicle at a light in a system
- * It Stores the 'light', a pointer to the lights struct that it is at
- * as well as an integer to store which iteration this vehicle was generated in
-*/
-struct Vehicle {
-    struct Lights *light;
-    int iterationGenerated;
-};
-
-/*
- * Lights is a struct which represents a light in the system
- * It stores the following
- * int lightPeriod - an integer to store the number of iterations that this light remains green for
-    int timer - a timer integer to act as a timer when the light is green
-    float avgTime - a float to store the average time that vehicles have waited at this light for
-    int maxTime - an integer to store the maximum number of time a vehicle has waited at this light for
-    int numOfVehicles - the number of vehicles that are waiting for OR passed through this light
-    int clearanceTime - the number of iterations that have passed for the light to clear AFTER the cars have stopped arriving
-    int status - status to show if this light is red(0) or green(1)
-*/
-struct Lights {
-    int lightPeriod;
-    int timer;
-    float avgTime;
-    int maxTime;
-    int numOfVehicles;
-    int clearanceTime;
-    int status;
-};
-
-/*
- * The Node struct represents a Node in the system, each node holds a pointer to a vehicle as well as a pointer to the
- * next node. These nodes form a linked list to represent the queue of cars at each light
-*/
-typedef struct Node {
-    struct Vehicle *vehicle;
-    struct Node *next;
-}NODE;
+#include <string.h>
+#include <math.h>
+
+/* The number of vehicles a light's queue can hold before it first has to grow, this must be a power of 2 */
+#define INITIAL_QUEUE_CAPACITY 64
+
+/* The gap used by the event engine for a light change that will never happen */
+#define EVENT_NEVER 0x3fffffff
 
 /**
- * The Function gets the last node in the linked list when passed a pointer to the head, and returns a pointer to it
- * @param node - pointer to the head node of the linked list
- * @return - a pointer to the last node in the list
+ * init_lights sets up a light with an empty queue, no statistics, no trace and no histogram, before init_queue is called
+ * @param light - pointer to the lights to set up
+ * @param lightPeriod - the number of iterations that the light stays green for
+ * @param status - whether the light starts red(0) or green(1)
  */
-struct Node* get_last_node(struct Node *node){
-    /* whilst a next node is present, move to the next node */
-    while (node->next != NULL){
-        node = node->next;
-    }
-    /* when there is no next node, the last node has been found, return this */
-    return node;
+void init_lights(struct Lights *light, int lightPeriod, int status){
+    memset(light, 0, sizeof(*light));
+    light->lightPeriod = lightPeriod;
+    light->timer = lightPeriod;
+    light->status = status;
+    light->queue = NULL;
+    light->trace = NULL;
+    light->waits = NULL;
 }
 
 /**
- * add_node takes details of the correct head node, lights and current iteration to add a new node to the linked list
- * @param head - a pointer to the head node of the linked list
- * @param light - a pointer to the lights that this vehicle will be at
- * @param iteration - the iteration value that this node is being created at
- * @return - an integer to state whether this addition was successful or not
+ * init_queue mallocs the initial space for a light's queue
+ * @param light - pointer to the lights whose queue is being created
+ * @return - an integer to state whether this was successful(0) or not(1)
  */
-int add_node(NODE *head, struct Lights *light, int iteration){
-
-    /* malloc the space for a new vehicle and store the pointer to this space */
-    struct Vehicle *tmp_vehicle = (struct Vehicle*) malloc(sizeof(struct Vehicle));
+int init_queue(struct Lights *light){
+    /* malloc the space for the ring buffer and store the pointer to this space */
+    light->queue = (struct Vehicle*) malloc(sizeof(struct Vehicle) * INITIAL_QUEUE_CAPACITY);
     /* check that this malloc was successful */
-    if (tmp_vehicle == NULL) {
+    if (light->queue == NULL) {
         /* if the malloc is unsuccessful, then return 1 */
         return 1;
     }
-    /* set the variables of the node's   vehicle to the correct values */
-    tmp_vehicle->iterationGenerated = iteration;
-    tmp_vehicle->light = light;
+    light->head = 0;
+    light->length = 0;
+    light->capacity = INITIAL_QUEUE_CAPACITY;
+    COUNT(allocations);
+    return 0;
+}
 
-    /* malloc the space for a new node and store the pointer to this space */
-    NODE *tmp_node = (struct Node*) malloc(sizeof(NODE));
-    /* check that this malloc was successful */
-    if (tmp_node == NULL) {
-        /* if the malloc is unsuccessful, then return 1 */
+/**
+ * grow_queue doubles the space of a full queue, moving the vehicles so that they start at the front of the buffer
+ * @param light - pointer to the lights whose queue is full
+ * @return - an integer to state whether this was successful(0) or not(1)
+ */
+int grow_queue(struct Lights *light){
+    /* realloc the buffer to twice its size */
+    struct Vehicle *tmp_queue = (struct Vehicle*) realloc(light->queue, sizeof(struct Vehicle) * light->capacity * 2);
+    /* check that this realloc was successful */
+    if (tmp_queue == NULL) {
+        /* if the realloc is unsuccessful, then return 1, the old queue is still valid */
         return 1;
     }
+    /* the vehicles that wrapped round to the start of the old buffer are moved to just after the old end */
+    int i;
+    for(i = 0; i < light->head; i++){
+        tmp_queue[light->capacity + i] = tmp_queue[i];
+    }
+    light->queue = tmp_queue;
+    light->capacity *= 2;
+    COUNT(allocations);
+    return 0;
+}
 
-    /* set the variables of the node to the correct values */
-    tmp_node->vehicle = tmp_vehicle;
-    tmp_node->next = NULL;
-
-    /* use the get_last_node function to add the pointer to the node to the 'next' variable of the last node
-     * essentially adding this node to the end of the linked list*/
-    NODE *last_item = get_last_node(head);
-    last_item->next = tmp_node;
+/**
+ * add_node adds a new vehicle to the back of a light's queue
+ * @param light - a pointer to the lights that this vehicle will be at
+ * @param iteration - the iteration value that this vehicle is being created at
+ * @return - an integer to state whether this addition was successful(0) or not(1)
+ */
+int add_node(struct Lights *light, int iteration){
+    /* if the queue is full, make space for more vehicles */
+    if(light->length == light->capacity && grow_queue(light) == 1){
+        /* if there is no space, then return 1 */
+        return 1;
+    }
+    /* store the vehicle in the slot after the current last vehicle */
+    light->queue[(light->head + light->length) & (light->capacity - 1)].iterationGenerated = iteration;
+    light->length++;
 
     /* increment the number of vehicles that have been added to this light */
     light->numOfVehicles++;
+    return 0;
 }
 
 /**
- * add_stats takes a vehicle and an iteration and adds the statistics of this vehicle the the data of its corresponding light
- * @param vehicle  - pointer to the vehicle whost stats we are using
+ * add_stats takes a vehicle and an iteration and adds the statistics of this vehicle the the data of its light
+ * @param light - pointer to the lights the vehicle passed through
+ * @param vehicle  - the vehicle whose stats we are using
  * @param iteration - iteration that we are currently in when calling this function
  */
-void add_stats(struct Vehicle *vehicle, int iteration){
-    /* re-calculate the average waiting time for the lights this vehicle is at */
-    vehicle->light->avgTime = ((float)(iteration - vehicle->iterationGenerated) + vehicle->light->avgTime)/2;
+void add_stats(struct Lights *light, struct Vehicle vehicle, int iteration){
+    /* re-calculate the average waiting time for the lights this vehicle is at, as a running mean of every vehicle */
+    light->numPassed++;
+    light->avgTime += ((float)(iteration - vehicle.iterationGenerated) - light->avgTime) / light->numPassed;
 
     /* re-calculate the maximum waiting time for the lights this vehicle is at */
-    if(iteration - vehicle->iterationGenerated > vehicle->light->maxTime){
-        vehicle->light->maxTime = iteration - vehicle->iterationGenerated;
+    if(iteration - vehicle.iterationGenerated > light->maxTime){
+        light->maxTime = iteration - vehicle.iterationGenerated;
+    }
+
+    /* and add its waiting time to the light's histogram when the waiting times are being recorded */
+    if(light->waits != NULL){
+        unsigned int wait = (unsigned int)(iteration - vehicle.iterationGenerated);
+        HISTOGRAM_ADD(light->waits, wait);
     }
 }
 
 /**
- * remove_first_node removes the node which is at the front of the linked list (the noed acting as the car nearest to the lights)
- * @param head - the head node of the linked list
+ * remove_first_node removes the vehicle which is at the front of a light's queue (the car nearest to the lights)
+ * @param light - pointer to the lights whose queue the vehicle is removed from
  * @param iteration - iteration that we are currently in when calling this function
- * @return - an integer to whether ths function was successful
+ * @return - an integer to state whether a vehicle was removed(0) or the queue was empty(1)
  */
-int remove_first_node(NODE *head, int iteration){
-    /* if the head's next parameter is null, the list is empty, so return 1 */
-    if (head->next == NULL){
+int remove_first_node(struct Lights *light, int iteration){
+    /* if the queue has no vehicles, the list is empty, so return 1 */
+    if (light->length == 0){
         return 1;
     }
-     /* get the first node in the list and store it as in tmp_node */
-    NODE* tmp_node = head->next;
-    /* set the heads' next parameter to the node after the node we are removing */
-    head->next = head->next->next;
-
-    /* add the stats of the node we are removing's vehicle to the lights it passed */
-    add_stats(tmp_node->vehicle, iteration);
-
-    /* free the memory belonging to this vehicle's struct */
-    free(tmp_node->vehicle);
-    /* free the memory belonging to this node's struct */
-    free(tmp_node);
+    /* add the stats of the vehicle we are removing to the lights it passed */
+    add_stats(light, light->queue[light->head], iteration);
+    /* and record it when tracing */
+    if(light->trace != NULL){
+        trace_add(light->trace, light->side, light->queue[light->head].iterationGenerated, iteration);
+    }
 
+    /* move the head on to the next vehicle */
+    light->head = (light->head + 1) & (light->capacity - 1);
+    light->length--;
+    return 0;
 }
 
 /**
- * Takes the head node and checks if the linked list is empty
- * @param node - the head node of the linked list
- * @return - an integer to specify whether the linked list is empty(1) of not(0)
+ * Takes a light and checks if its queue is empty
+ * @param light - pointer to the lights whose queue is checked
+ * @return - an integer to specify whether the queue is empty(1) of not(0)
  */
-int is_empty(NODE *node){
-    /* if the head nodes' has no next node, the linked list is empty */
-    if (node->next == NULL) {
+int is_empty(struct Lights *light){
+    /* if the queue holds no vehicles, it is empty */
+    if (light->length == 0) {
         /* return 1 */
         return 1;
     }else{
-        /* otherwise, the list is not empty, return 0 */
+        /* otherwise, the queue is not empty, return 0 */
         return 0;
     }
 }
@@ -172,6 +172,7 @@ int update_light(struct Lights *light, struct Lights *other){
         light->status = 0;
         /* set the red lights' status to 1(Green) */
         other->status = 1;
+        COUNT(lightSwitches);
         /* return 1 as the light changed color */
         return 1;
     }else{
@@ -185,146 +186,465 @@ int update_light(struct Lights *light, struct Lights *other){
 
 /**
  * function to get a random value between 0 and 100
+ * @param rng - pointer to the random stream of the current simulation
  * @return a random float between 0 and 100
  */
-float get_random_val() {
-    /* initialise the variables belonging to the GSL library */
-    const gsl_rng_type *T;
-    gsl_rng *r;
-    gsl_rng_env_setup();
-    /* get information based on the current time */
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    /* seed the random function based on the current time */
-    unsigned long mySeed = tv.tv_sec + tv.tv_usec;
-    T = gsl_rng_default;
-    r = gsl_rng_alloc(T);
-    gsl_rng_set(r, mySeed);
-    /* ger a random float between 0 and 1 */
-    double u = gsl_rng_uniform(r);
-    gsl_rng_free(r);
-    /* return theis value multiplied by 100 */
+float get_random_val(SimRandom *rng) {
+    /* get a random double between 0 and 1 from this simulation's stream */
+    double u = sim_random_uniform(rng);
+    /* return this value multiplied by 100 */
     return ((float)u * 100);
 }
 
 /**
- * the runOneSimulation function takes in the 4 required parameters adn runs 500 loops of the lights where cars can be
- * randomly added and light changed, then after 100 iterations, the light continue changing to empty all the traffic
- * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
- * @param lightPeriodLHS - The period that the Left light stays active for (an integer for the number of iterations)
- * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
- * @param lightPeriodRHS - The period that the Left light stays active for (an integer for the number of iterations)
- * @return - a ReturnData struct containing statistics about the vehicles at each light
+ * arrival_threshold gets the integer threshold of a light's arrival test, a vehicle arrives on an iteration when the
+ * raw random word drawn for it is below the threshold, which happens with probability arrivalRate / 100
+ * @param arrivalRate - the arrival rate of the light (a integer percentage between 0 and 100)
+ * @return - the threshold, from 0 (vehicles never arrive) to 2^32 (a vehicle arrives on every iteration)
  */
-ReturnData runOneSimulation(int arrivalRateLHS,
-                     int lightPeriodLHS,
-                     int arrivalRateRHS,
-                     int lightPeriodRHS){
+uint64_t arrival_threshold(int arrivalRate){
+    if(arrivalRate <= 0){
+        return 0;
+    }
+    if(arrivalRate >= 100){
+        return (uint64_t)1 << 32;
+    }
+    return ((uint64_t)arrivalRate << 32) / 100;
+}
 
-    /* create two Lights structs for each light and initialise the values accordingly */
-    struct Lights leftLight = {lightPeriodLHS, lightPeriodLHS, 0, 0, 0, 0, 0};
-    struct Lights rightLight = {lightPeriodRHS, lightPeriodRHS, 0, 0, 0, 0, 1};
+/**
+ * arrival_log_miss gets the log of the chance that no vehicle arrives on an iteration, for arrival_gap
+ * @param threshold - the arrival threshold of the light, below ARRIVAL_SPARSE_THRESHOLD
+ * @return - log(1 - threshold / 2^32)
+ */
+double arrival_log_miss(uint64_t threshold){
+    return log(1.0 - threshold / 4294967296.0);
+}
 
-    /* malloc the space for the right linked list's head node and store the pointer to this space */
-    NODE *rightLightHead = (NODE*) malloc(sizeof(NODE));
-    /* check that this malloc was successful */
-    if (rightLightHead == NULL) {
-        /* if the malloc is unsuccessful, then return an empty ReturnData instance with the status 1 */
-        ReturnData tmp = {0,0,0,0,0,0,0,0,0};
-        return tmp;
+/**
+ * arrival_gap turns a raw random word into the number of iterations without an arrival before the next one, which is
+ * geometric with the chance of an arrival of the threshold the log of a miss was worked out from
+ * @param word - the random word
+ * @param logMiss - the arrival_log_miss of the light
+ * @return - the gap, from 0 (a vehicle arrives on the next iteration) to ARRIVAL_BLOCK (none in a whole block)
+ */
+int arrival_gap(uint32_t word, double logMiss){
+    /* the gap is at least k when u, which is in (0, 1], is at most (1 - p)^k */
+    double gap = log((word + 1.0) * (1.0 / 4294967296.0)) / logMiss;
+    return gap >= ARRIVAL_BLOCK ? ARRIVAL_BLOCK : (int)gap;
+}
+
+/**
+ * arrival_mask draws the arrivals of one light for the next ARRIVAL_BLOCK iterations, bit i of the mask being set when
+ * a vehicle arrives on the i-th of those iterations. Each iteration is normally decided by its own raw random word,
+ * but the arrivals of a light below ARRIVAL_SPARSE_THRESHOLD are placed by drawing the gaps between them, which takes
+ * one word per arrival rather than one per iteration, with the rest of the block's words skipped so that the stream
+ * is left in the same place either way. Synced runs always compare each word, as the gaps would give the words to
+ * different iterations at different rates and the common random numbers of runCompare would no longer line up
+ * @param rng - pointer to the random stream of the current simulation
+ * @param threshold - the arrival threshold of the light, from arrival_threshold
+ * @param variates - the VARIATES_ flags of the simulation, antithetic runs use the complement of every word
+ * @return - the arrival mask of the block
+ */
+uint64_t arrival_mask(SimRandom *rng, uint64_t threshold, int variates){
+    uint32_t words[ARRIVAL_BLOCK];
+    uint32_t flip = (variates & VARIATES_ANTITHETIC) ? 0xFFFFFFFFU : 0;
+    uint64_t mask = 0;
+    int i;
+    /* a light whose arrivals are certain doesn't need any words, unless its draws have to line up with other runs */
+    if((variates & VARIATES_SYNCED) == 0){
+        if(threshold == 0){
+            return 0;
+        }
+        if(threshold > 0xFFFFFFFFU){
+            return ~(uint64_t)0;
+        }
+    }
+    if((variates & VARIATES_SYNCED) == 0 && threshold != 0 && threshold < ARRIVAL_SPARSE_THRESHOLD){
+        double logMiss = arrival_log_miss(threshold);
+        int drawn = 0;
+        i = 0;
+        while(1){
+            i += arrival_gap(sim_random_next(rng) ^ flip, logMiss);
+            drawn++;
+            if(i >= ARRIVAL_BLOCK){
+                break;
+            }
+            mask |= (uint64_t)1 << i;
+            if(++i == ARRIVAL_BLOCK){
+                break;
+            }
+        }
+        sim_random_skip(rng, ARRIVAL_BLOCK - drawn);
+        return mask;
+    }
+    sim_random_fill(rng, words, ARRIVAL_BLOCK);
+    /* the compare of each word gives one bit, with no branches, so the compiler is free to vectorise the loop */
+    for(i = 0; i < ARRIVAL_BLOCK; i++){
+        mask |= (uint64_t)((words[i] ^ flip) < threshold) << i;
     }
-    /* set the variables for the head node to NULL */
-    rightLightHead->next = NULL;
-    rightLightHead->vehicle = NULL;
+    return mask;
+}
 
-    /* malloc the space for the left linked list's head node and store the pointer to this space */
-    NODE *leftLightHead = (NODE*) malloc(sizeof(NODE));
-    /* check that this malloc was successful */
-    if (leftLightHead == NULL) {
-        /* if the malloc is unsuccessful, then return an empty ReturnData instance with the status 1 */
-        ReturnData tmp = {0,0,0,0,0,0,0,0,0};
-        return tmp;
+/**
+ * arrivals_init sets up the arrivals of a simulation, before its first block has been drawn
+ * @param arrivals - pointer to the arrivals to set up
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param variates - the VARIATES_ flags of the simulation
+ */
+void arrivals_init(Arrivals *arrivals, int arrivalRateLHS, int arrivalRateRHS, int variates){
+    arrivals->thresholdLHS = arrival_threshold(arrivalRateLHS);
+    arrivals->thresholdRHS = arrival_threshold(arrivalRateRHS);
+    arrivals->maskLHS = 0;
+    arrivals->maskRHS = 0;
+    arrivals->start = -ARRIVAL_BLOCK;
+    arrivals->variates = variates;
+}
+
+/**
+ * arrivals_advance draws the blocks of arrivals up to the one holding an iteration, the left light drawing first and
+ * the right light second in each block, blocks are always drawn in order so the same stream gives the same arrivals
+ * however the iterations are visited
+ * @param arrivals - pointer to the arrivals of the simulation
+ * @param rng - pointer to the random stream of the simulation
+ * @param iteration - the iteration whose block is needed, which must not be before the current block
+ */
+void arrivals_advance(Arrivals *arrivals, SimRandom *rng, long iteration){
+    while(iteration >= arrivals->start + ARRIVAL_BLOCK){
+        arrivals->maskLHS = arrival_mask(rng, arrivals->thresholdLHS, arrivals->variates);
+        arrivals->maskRHS = arrival_mask(rng, arrivals->thresholdRHS, arrivals->variates);
+        arrivals->start += ARRIVAL_BLOCK;
     }
-    /* set the variables for the head node to NULL */
-    leftLightHead->next = NULL;
-    leftLightHead->vehicle = NULL;
+}
 
-    /* declare and instantiate the variables to control the running of the while loop below */
+/**
+ * run_tick_engine runs the simulation one iteration at a time, taking the arrivals of each iteration from the
+ * arrival masks, which are drawn for ARRIVAL_BLOCK iterations at a time
+ * @param leftLight - pointer to the left light, with an empty queue
+ * @param rightLight - pointer to the right light, with an empty queue
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param rng - pointer to the random stream of this simulation
+ * @param max - the number of iterations where vehicles are allowed to arrive
+ * @param variates - the VARIATES_ flags of the simulation
+ */
+void run_tick_engine(struct Lights *leftLight, struct Lights *rightLight, int arrivalRateLHS, int arrivalRateRHS,
+                     SimRandom *rng, int max, int variates){
+    /* declare and instantiate the variable to control the running of the while loop below */
     int iteration = 0;
-    int max = 500;
+    Arrivals arrivals;
+    arrivals_init(&arrivals, arrivalRateLHS, arrivalRateRHS, variates);
 
     while(1){
 
         /* if we have exceeded the number of iterations where vehicles are allowed to arrive(500) */
         if(iteration>max){
             /* if the right light is not empty, then increment the right lights clearance time */
-            if(is_empty(rightLightHead) == 0){
-                rightLight.clearanceTime++;
+            if(is_empty(rightLight) == 0){
+                rightLight->clearanceTime++;
             }
             /* if the left light is not empty, then increment the left lights clearance time */
-            if(is_empty(leftLightHead) == 0){
-                leftLight.clearanceTime++;
+            if(is_empty(leftLight) == 0){
+                leftLight->clearanceTime++;
             }
             /* if both the right and left lights are empty, then break out of the while loop as we have finished iterating */
-            if (is_empty(rightLightHead) == 1 && is_empty(leftLightHead) == 1){
+            if (is_empty(rightLight) == 1 && is_empty(leftLight) == 1){
                 break;
             }
         }
+        COUNT_PHASE(iteration, max);
+        COUNT_TICKS(iteration, 1, max);
 
         /* update the status of the lights, passing in the green light as the first parameter */
         /* store the result in light_changed, which stores if a light was changed(1) or not(0) */
         int light_changed = 0;
-        if(rightLight.status == 1){
-            light_changed = update_light(&rightLight, &leftLight);
-        }else if(leftLight.status == 1){
-            light_changed = update_light(&leftLight, &rightLight);
+        if(rightLight->status == 1){
+            light_changed = update_light(rightLight, leftLight);
+        }else if(leftLight->status == 1){
+            light_changed = update_light(leftLight, rightLight);
         }
 
-
-
         /* if the lights didn't change AND we have not exceeded the maximum number of iterations where cars can spawn */
         if(light_changed == 0){
 
             if(iteration < max) {
-                /* get two random values between 0 and 100  */
-                float left_rand = get_random_val();
-                float right_rand = get_random_val();
-
-                /* if this random value for the left light is less than the arrival rate passed in (probability) add a vehicle to the left queue*/
-                if ((int) left_rand <= arrivalRateLHS) {
-                    add_node(leftLightHead, &leftLight, iteration);
+                /* find this iteration's bit in the arrival masks, drawing the next block when this one is used up */
+                arrivals_advance(&arrivals, rng, iteration);
+                int bit = (int)(iteration - arrivals.start);
+                /* if the left light's bit is set, add a vehicle to the left queue */
+                if ((arrivals.maskLHS >> bit) & 1) {
+                    add_node(leftLight, iteration);
+                    COUNT(arrivalsLHS);
+                    COUNT_MAX(highWaterLHS, leftLight->length);
                 }
-                /* if this random value for the right light is less than the arrival rate passed in (probability) add a vehicle to the right queue*/
-                if (((int) right_rand <= arrivalRateRHS)) {
-                    add_node(rightLightHead, &rightLight, iteration);
+                /* if the right light's bit is set, add a vehicle to the right queue */
+                if ((arrivals.maskRHS >> bit) & 1) {
+                    add_node(rightLight, iteration);
+                    COUNT(arrivalsRHS);
+                    COUNT_MAX(highWaterRHS, rightLight->length);
                 }
             }
 
             /* if one of the lights is green, remove a node from this light */
-            if(rightLight.status==1){
-                remove_first_node(rightLightHead, iteration);
-            }else if(leftLight.status==1){
-                remove_first_node(leftLightHead, iteration);
+            if(rightLight->status==1){
+                if(remove_first_node(rightLight, iteration) == 0){
+                    COUNT(departuresRHS);
+                }
+            }else if(leftLight->status==1){
+                if(remove_first_node(leftLight, iteration) == 0){
+                    COUNT(departuresLHS);
+                }
             }
         }
         /* increment the value of iteration as an iteration has completed */
         iteration++;
     }
 
-    /* free the two malloced heads for the linked list */
-    free(rightLightHead);
-    free(leftLightHead);
+}
+
+/**
+ * arrival_probability gets the chance that a vehicle arrives on an iteration, matching the test of arrival_mask
+ * @param arrivalRate - the arrival rate of the light (a integer percentage between 0 and 100)
+ * @return - the probability of an arrival on an iteration where vehicles can arrive
+ */
+double arrival_probability(int arrivalRate){
+    return arrival_threshold(arrivalRate) / 4294967296.0;
+}
+
+/**
+ * next_arrival finds the first iteration from iteration up to (but not including) limit where a vehicle arrives at
+ * either light, scanning the arrival masks a block at a time
+ * @param arrivals - pointer to the arrivals of the simulation
+ * @param rng - pointer to the random stream of the simulation
+ * @param iteration - the first iteration to look at
+ * @param limit - the iteration to stop at, which must not be after the last iteration where vehicles can arrive
+ * @return - the iteration of the next arrival, or limit if there is none before it
+ */
+int next_arrival(Arrivals *arrivals, SimRandom *rng, int iteration, int limit){
+    while(iteration < limit){
+        arrivals_advance(arrivals, rng, iteration);
+        uint64_t pending = (arrivals->maskLHS | arrivals->maskRHS) >> (iteration - arrivals->start);
+        if(pending != 0){
+            /* the lowest set bit is the next arrival */
+            int next = iteration + __builtin_ctzll(pending);
+            return next < limit ? next : limit;
+        }
+        iteration = (int)arrivals->start + ARRIVAL_BLOCK;
+    }
+    return limit;
+}
+
+/**
+ * run_event_engine runs the same model as run_tick_engine, but only visits the iterations where something happens
+ * The next arrival is found by scanning the same arrival masks as the tick engine for their next set bit and the
+ * light changes are worked out from the green light's timer, so runs of iterations where the green queue is empty and
+ * no vehicle arrives are skipped over in one step, giving exactly the results of the tick engine
+ * @param leftLight - pointer to the left light, with an empty queue
+ * @param rightLight - pointer to the right light, with an empty queue
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param rng - pointer to the random stream of this simulation
+ * @param max - the number of iterations where vehicles are allowed to arrive
+ * @param variates - the VARIATES_ flags of the simulation
+ */
+void run_event_engine(struct Lights *leftLight, struct Lights *rightLight, int arrivalRateLHS, int arrivalRateRHS,
+                      SimRandom *rng, int max, int variates){
+    Arrivals arrivals;
+    arrivals_init(&arrivals, arrivalRateLHS, arrivalRateRHS, variates);
+    int iteration = 0;
+
+    while(1){
+        /* the light that is currently green, and the other (red) light */
+        struct Lights *green = rightLight->status == 1 ? rightLight : leftLight;
+        struct Lights *red = green == rightLight ? leftLight : rightLight;
+
+        /* once vehicles have stopped arriving, finish when both queues are empty */
+        if(iteration > max && is_empty(rightLight) == 1 && is_empty(leftLight) == 1){
+            break;
+        }
+        COUNT_PHASE(iteration, max);
+
+        /* if the green light's timer has run out, this iteration only changes the lights */
+        if(green->timer == 0){
+            if(iteration > max){
+                /* count this iteration towards the clearance time of every light with vehicles still waiting */
+                rightLight->clearanceTime += is_empty(rightLight) == 0;
+                leftLight->clearanceTime += is_empty(leftLight) == 0;
+            }
+            update_light(green, red);
+            COUNT_TICKS(iteration, 1, max);
+            iteration++;
+            continue;
+        }
+
+        /* look up whether a vehicle arrives at each light on this iteration */
+        int arriving = iteration < max;
+        int leftArrives = 0, rightArrives = 0;
+        if(arriving){
+            arrivals_advance(&arrivals, rng, iteration);
+            leftArrives = (int)((arrivals.maskLHS >> (iteration - arrivals.start)) & 1);
+            rightArrives = (int)((arrivals.maskRHS >> (iteration - arrivals.start)) & 1);
+        }
+        if(leftArrives || rightArrives || is_empty(green) == 0){
+            /* something happens on this iteration, so run it exactly as the tick engine would */
+            if(iteration > max){
+                rightLight->clearanceTime += is_empty(rightLight) == 0;
+                leftLight->clearanceTime += is_empty(leftLight) == 0;
+            }
+            update_light(green, red);
+            if(leftArrives){
+                add_node(leftLight, iteration);
+                COUNT(arrivalsLHS);
+                COUNT_MAX(highWaterLHS, leftLight->length);
+            }
+            if(rightArrives){
+                add_node(rightLight, iteration);
+                COUNT(arrivalsRHS);
+                COUNT_MAX(highWaterRHS, rightLight->length);
+            }
+            if(remove_first_node(green, iteration) == 0){
+                if(green == leftLight){
+                    COUNT(departuresLHS);
+                }else{
+                    COUNT(departuresRHS);
+                }
+            }
+            COUNT_TICKS(iteration, 1, max);
+            iteration++;
+            continue;
+        }
+
+        /* nothing happens until the lights change, a vehicle arrives, or vehicles stop arriving, so skip to the first
+         * of these (a negative timer never runs out) */
+        int skip = green->timer > 0 ? green->timer : EVENT_NEVER;
+        if(arriving){
+            if(max - iteration < skip){
+                skip = max - iteration;
+            }
+            skip = next_arrival(&arrivals, rng, iteration, iteration + skip) - iteration;
+        }else if(iteration <= max && is_empty(red) == 1 && max + 1 - iteration < skip){
+            /* with both queues empty the simulation ends on the first iteration after max */
+            skip = max + 1 - iteration;
+        }
+        /* the red queue waits through every skipped iteration after max */
+        int first = iteration > max ? iteration : max + 1;
+        if(iteration + skip > first && is_empty(red) == 0){
+            red->clearanceTime += iteration + skip - first;
+        }
+        if(green->timer > 0){
+            green->timer -= skip;
+        }
+        COUNT_TICKS(iteration, skip, max);
+        iteration += skip;
+    }
+}
+
+/**
+ * run_junction runs one simulation of a junction whose lights have been set up with empty queues, leaving the
+ * queues for the caller to free
+ * @param leftLight - pointer to the left light, with an empty queue
+ * @param rightLight - pointer to the right light, with an empty queue
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param seed - The master seed of the run, shared by all replications
+ * @param replication - The index of this replication, which selects its own independent random stream
+ * @param engine - The engine used to run the simulation, ENGINE_TICK or ENGINE_EVENT
+ * @param variates - VARIATES_PLAIN, or VARIATES_ flags to draw the arrivals for variance reduction
+ * @param max - the number of iterations where vehicles are allowed to arrive
+ * @return - a ReturnData struct containing statistics about the vehicles at each light
+ */
+ReturnData run_junction(struct Lights *leftLight, struct Lights *rightLight, int arrivalRateLHS, int arrivalRateRHS,
+                        unsigned long seed, unsigned long replication, int engine, int variates, int max){
+    /* create the random stream once for this simulation, so the same seed and replication always replay the same run */
+    SimRandom rng;
+    sim_random_init(&rng, seed, replication);
+
+    /* run the simulation with the chosen engine */
+    COUNT_START();
+    if(engine == ENGINE_EVENT){
+        run_event_engine(leftLight, rightLight, arrivalRateLHS, arrivalRateRHS, &rng, max, variates);
+    }else{
+        run_tick_engine(leftLight, rightLight, arrivalRateLHS, arrivalRateRHS, &rng, max, variates);
+    }
+    COUNT_END();
 
     /* Return the ReturnData struct with the stats of each of the lights and the status 1 as the function completed successfully */
-    ReturnData res = {rightLight.avgTime,
-                    rightLight.maxTime,
-                    rightLight.numOfVehicles,
-                    rightLight.clearanceTime,
-                    leftLight.avgTime,
-                    leftLight.maxTime,
-                    leftLight.numOfVehicles,
-                    leftLight.clearanceTime,
+    ReturnData res = {rightLight->avgTime,
+                    rightLight->maxTime,
+                    rightLight->numOfVehicles,
+                    rightLight->clearanceTime,
+                    leftLight->avgTime,
+                    leftLight->maxTime,
+                    leftLight->numOfVehicles,
+                    leftLight->clearanceTime,
                     1};
+    return res;
+}
+
+/**
+ * the runOneSimulation function takes in the 4 required parameters adn runs 500 loops of the lights where cars can be
+ * randomly added and light changed, then after 100 iterations, the light continue changing to empty all the traffic
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param lightPeriodLHS - The period that the Left light stays active for (an integer for the number of iterations)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param lightPeriodRHS - The period that the Left light stays active for (an integer for the number of iterations)
+ * @param seed - The master seed of the run, shared by all replications
+ * @param replication - The index of this replication, which selects its own independent random stream
+ * @param engine - The engine used to run the simulation, ENGINE_TICK or ENGINE_EVENT
+ * @param variates - VARIATES_PLAIN, or VARIATES_ flags to draw the arrivals for variance reduction
+ * @return - a ReturnData struct containing statistics about the vehicles at each light
+ */
+ReturnData runOneSimulation(int arrivalRateLHS,
+                     int lightPeriodLHS,
+                     int arrivalRateRHS,
+                     int lightPeriodRHS,
+                     unsigned long seed,
+                     unsigned long replication,
+                     int engine,
+                     int variates){
+
+    /* create two Lights structs for each light and initialise the values accordingly */
+    struct Lights leftLight, rightLight;
+    init_lights(&leftLight, lightPeriodLHS, 0);
+    init_lights(&rightLight, lightPeriodRHS, 1);
+
+    /* malloc the space for the queue of each light */
+    if (init_queue(&rightLight) == 1) {
+        /* if the malloc is unsuccessful, then return an empty ReturnData instance with the status 0 */
+        ReturnData tmp = {0,0,0,0,0,0,0,0,0};
+        return tmp;
+    }
+    if (init_queue(&leftLight) == 1) {
+        /* if the malloc is unsuccessful, then return an empty ReturnData instance with the status 0 */
+        free(rightLight.queue);
+        ReturnData tmp = {0,0,0,0,0,0,0,0,0};
+        return tmp;
+    }
+
+    /* when tracing, record every vehicle of this replication in this thread's trace buffer */
+    struct TraceBuffer *trace = trace_thread_buffer();
+    if(trace != NULL){
+        trace->replication = (uint32_t)replication;
+        leftLight.trace = trace;
+        leftLight.side = TRACE_LHS;
+        rightLight.trace = trace;
+        rightLight.side = TRACE_RHS;
+    }
+    /* and when recording the waiting times, add them to this thread's histograms */
+    WaitHistograms *waits = histogram_thread_buffer();
+    if(waits != NULL){
+        leftLight.waits = &waits->side[HISTOGRAM_LHS];
+        rightLight.waits = &waits->side[HISTOGRAM_RHS];
+    }
+
+    /* run the simulation, with vehicles allowed to arrive for the first ARRIVAL_ITERATIONS iterations */
+    ReturnData res = run_junction(&leftLight, &rightLight, arrivalRateLHS, arrivalRateRHS, seed, replication, engine,
+                                  variates, ARRIVAL_ITERATIONS);
+
+    /* free the two malloced queues */
+    free(rightLight.queue);
+    free(leftLight.queue);
 
     return res;
 
@@ -1,21 +1,85 @@
 #ifndef ECM2433___CW_RUNONESIMULATION_H
 #define ECM2433___CW_RUNONESIMULATION_H
 
-/* If this file hasn't already been imported, define the struct Res*/
-
-/* The struct Res, aka ReturnData creates a neat and usable datatype to allow the
- * required data to be returned by the runOneSimulation in runOneSimulation.c*/
-typedef struct Res {
-    float avgTimeRHS;
-    float maxTimeRHS;
-    float numOfVehiclesRHS;
-    float clearanceTimeRHS;
-    float avgTimeLHS;
-    float maxTimeLHS;
-    float numOfVehiclesLHS;
-    float clearanceTimeLHS;
-    float status;
-}ReturnData;
+/* Include the random stream that each simulation draws from */
+#include "simRandom.h"
+
+/* Include the public types, for the struct Res (ReturnData) and the ENGINE_ and VARIATES_ values */
+#include "simTypes.h"
+
+/*
+ * Vehicle is a struct that represents a vehicle at a light in a system
+ * It stores an integer to store which iteration this vehicle was generated in, the light it is at is the one whose
+ * queue holds it
+*/
+struct Vehicle {
+    int iterationGenerated;
+};
+
+/*
+ * Lights is a struct which represents a light in the system
+ * It stores the following
+ * int lightPeriod - an integer to store the number of iterations that this light remains green for
+    int timer - a timer integer to act as a timer when the light is green
+    float avgTime - a float to store the average time that vehicles have waited at this light for
+    int maxTime - an integer to store the maximum number of time a vehicle has waited at this light for
+    int numOfVehicles - the number of vehicles that are waiting for OR passed through this light
+    int clearanceTime - the number of iterations that have passed for the light to clear AFTER the cars have stopped arriving
+    int status - status to show if this light is red(0) or green(1)
+    int numPassed - the number of vehicles that have passed through this light, which avgTime is the mean of
+    struct Vehicle *queue - a ring buffer holding the vehicles waiting at this light
+    int head - the index in queue of the vehicle nearest to the light
+    int length - the number of vehicles waiting in queue
+    int capacity - the number of vehicles queue has space for (always a power of 2)
+    struct TraceBuffer *trace - the buffer every vehicle passing this light is traced to, or NULL when not tracing
+    int side - the TRACE_ value of this light in the trace
+    struct Hist *waits - the histogram the waiting time of every vehicle passing this light is added to, or NULL
+*/
+struct Lights {
+    int lightPeriod;
+    int timer;
+    float avgTime;
+    int maxTime;
+    int numOfVehicles;
+    int clearanceTime;
+    int status;
+    int numPassed;
+    struct Vehicle *queue;
+    int head;
+    int length;
+    int capacity;
+    struct TraceBuffer *trace;
+    int side;
+    struct Hist *waits;
+};
+
+/* The number of iterations where vehicles are allowed to arrive in each simulation */
+#define ARRIVAL_ITERATIONS 500
+
+/* The version of the simulation model, which must go up whenever a change alters the results of runOneSimulation, so
+ * that results saved by earlier versions are not reused */
+#define SIM_MODEL_VERSION 3
+
+/* The number of iterations whose arrivals are drawn together, one bit of an arrival mask each */
+#define ARRIVAL_BLOCK 64
+
+/* Lights with an arrival threshold below this arrive so rarely that arrival_mask draws the gaps between their arrivals
+ * instead of a word for every iteration */
+#define ARRIVAL_SPARSE_THRESHOLD (((uint64_t)20 << 32) / 100)
+
+/* The struct ArrivalBlock, aka Arrivals, holds the arrivals of both lights for one block of ARRIVAL_BLOCK iterations
+ * thresholdLHS / thresholdRHS - a vehicle arrives when the random word drawn for an iteration is below this value
+ * maskLHS / maskRHS - bit i is set when a vehicle arrives on iteration start + i (unless the lights change on it)
+ * start - the first iteration of the block, -ARRIVAL_BLOCK before the first block has been drawn
+ * variates - the VARIATES_ flags of the simulation */
+typedef struct ArrivalBlock {
+    uint64_t thresholdLHS;
+    uint64_t thresholdRHS;
+    uint64_t maskLHS;
+    uint64_t maskRHS;
+    long start;
+    int variates;
+}Arrivals;
 
 #endif
 
@@ -23,5 +87,27 @@ typedef struct Res {
 ReturnData runOneSimulation(int arrivalRateLHS,
                      int lightPeriodLHS,
                      int arrivalRateRHS,
-                     int lightPeriodRHS);
+                     int lightPeriodRHS,
+                     unsigned long seed,
+                     unsigned long replication,
+                     int engine,
+                     int variates);
+
+ReturnData run_junction(struct Lights *leftLight, struct Lights *rightLight, int arrivalRateLHS, int arrivalRateRHS,
+                        unsigned long seed, unsigned long replication, int engine, int variates, int max);
 
+/* Declare the helper functions of runOneSimulation.c, which are also used by the benchmarks */
+void init_lights(struct Lights *light, int lightPeriod, int status);
+int init_queue(struct Lights *light);
+int add_node(struct Lights *light, int iteration);
+int remove_first_node(struct Lights *light, int iteration);
+int is_empty(struct Lights *light);
+int update_light(struct Lights *light, struct Lights *other);
+float get_random_val(SimRandom *rng);
+uint64_t arrival_threshold(int arrivalRate);
+double arrival_log_miss(uint64_t threshold);
+int arrival_gap(uint32_t word, double logMiss);
+uint64_t arrival_mask(SimRandom *rng, uint64_t threshold, int variates);
+void arrivals_init(Arrivals *arrivals, int arrivalRateLHS, int arrivalRateRHS, int variates);
+void arrivals_advance(Arrivals *arrivals, SimRandom *rng, long iteration);
+double arrival_probability(int arrivalRate);
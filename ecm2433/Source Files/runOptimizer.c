@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runOptimizer.h"
+
+/*
+ * runOptimizer searches every pair of light periods for the one with the lowest objective, using successive halving
+ * Every candidate starts with OPTIMIZER_FIRST_ROUND replications. After each round, any candidate whose 95% confidence
+ * interval lies wholly above the best candidate's is dropped, as is the worse half of what is left, and the survivors
+ * get twice as many replications the next round. This carries on until one candidate is left or the next round would
+ * go over options->replications.
+ * Every candidate runs the same replication numbers, so they all see the same random streams and the comparisons
+ * between them are not swamped by noise, and the results are folded in replication order so the search does not
+ * depend on the number of threads.
+*/
+
+/*
+ * Candidate is one pair of light periods under test
+ * RunningStat objective - the objective of each of its replications
+ * ResultStats stats - every ReturnData field of its replications
+*/
+struct Candidate {
+    SimConfig config;
+    RunningStat objective;
+    ResultStats stats;
+};
+
+/*
+ * OptimizerJob is the state shared by the workers while a round is run
+ * Task i of the pool runs batch (i % batches) of candidate alive[i / batches], a batch being lanes replications
+ * starting at replication first
+*/
+struct OptimizerJob {
+    struct Candidate *candidates;
+    int *alive;
+    SimOptions *options;
+    long first;
+    long count;
+    long batches;
+    int lanes;
+    ReturnData *results;
+};
+
+/**
+ * find_objective looks up an objective by the name used on the command line
+ * @param name - "wait" or "clearance"
+ * @return - the OBJECTIVE_ of that name, or -1 if there is none
+ */
+int find_objective(const char *name){
+    if(strcmp(name, "wait") == 0){
+        return OBJECTIVE_WAIT;
+    }
+    if(strcmp(name, "clearance") == 0){
+        return OBJECTIVE_CLEARANCE;
+    }
+    return -1;
+}
+
+/**
+ * get_objective works out the objective of a single replication
+ * @param res - the result of the replication
+ * @param objective - the OBJECTIVE_ to work out
+ * @return - the value of the objective, lower is better
+ */
+static double get_objective(ReturnData res, int objective){
+    if(objective == OBJECTIVE_CLEARANCE){
+        return res.clearanceTimeLHS > res.clearanceTimeRHS ? res.clearanceTimeLHS : res.clearanceTimeRHS;
+    }
+    double vehicles = (double)res.numOfVehiclesLHS + res.numOfVehiclesRHS;
+    if(vehicles == 0){
+        return 0;
+    }
+    return ((double)res.avgTimeLHS * res.numOfVehiclesLHS + (double)res.avgTimeRHS * res.numOfVehiclesRHS) / vehicles;
+}
+
+/**
+ * run_optimizer_task is the worker pool task that runs one batch of replications of one candidate
+ * @param index - the task index, see OptimizerJob
+ * @param arg - pointer to the OptimizerJob being run
+ */
+static void run_optimizer_task(long index, void *arg){
+    struct OptimizerJob *job = (struct OptimizerJob*) arg;
+    long candidate = index / job->batches;
+    long offset = (index % job->batches) * job->lanes;
+    SimConfig *c = &job->candidates[job->alive[candidate]].config;
+    ReturnData *results = job->results + candidate * job->count + offset;
+    int count = job->count - offset < job->lanes ? (int)(job->count - offset) : job->lanes;
+    if(job->options->backend == BACKEND_SIMD && job->options->engine == ENGINE_TICK){
+        runSimdBatch(c->arrivalRateLHS, c->lightPeriodLHS, c->arrivalRateRHS, c->lightPeriodRHS,
+                     job->options->seed, job->first + offset, count, results);
+    }else{
+        int i;
+        for(i = 0; i < count; i++){
+            results[i] = runOneSimulation(c->arrivalRateLHS, c->lightPeriodLHS, c->arrivalRateRHS, c->lightPeriodRHS,
+                                          job->options->seed, job->first + offset + i, job->options->engine,
+                                          VARIATES_PLAIN);
+        }
+    }
+}
+
+/**
+ * rank_candidates sorts the surviving candidates by their mean objective, best first, with an insertion sort that
+ * keeps tied candidates in the order they were in so the ranking is always the same
+ * @param candidates - the candidates
+ * @param alive - the indexes of the surviving candidates, sorted in place
+ * @param count - the number of surviving candidates
+ */
+static void rank_candidates(struct Candidate *candidates, int *alive, int count){
+    int i, j;
+    for(i = 1; i < count; i++){
+        int index = alive[i];
+        double mean = candidates[index].objective.mean;
+        for(j = i; j > 0 && candidates[alive[j - 1]].objective.mean > mean; j--){
+            alive[j] = alive[j - 1];
+        }
+        alive[j] = index;
+    }
+}
+
+/**
+ * runOptimizer searches for the light periods with the lowest objective, see the top of this file, and writes the
+ * best candidates with their confidence intervals and the total cost of the search to out
+ * @param search - the arrival rates, range of light periods and objective
+ * @param options - the seed, engine, backend and number of threads to use, replications is the most replications
+ *                  any one candidate is given
+ * @param out - the stream to write the report to
+ * @return - an integer to state whether the search was successful(0) or not(1)
+ */
+int runOptimizer(SearchOptions *search, SimOptions *options, FILE *out){
+    int side = search->maxPeriod - search->minPeriod + 1;
+    int numCandidates = side * side;
+    int numAlive = numCandidates;
+    int i, j;
+    long totalReplications = 0;
+    double totalTicks = 0;
+    struct OptimizerJob job;
+
+    /* malloc the candidates, the list of survivors, and the results of a round, no round is bigger than the first
+     * one plus the replications of one candidate */
+    long most = options->replications < OPTIMIZER_FIRST_ROUND ? OPTIMIZER_FIRST_ROUND : options->replications;
+    job.candidates = (struct Candidate*) malloc(sizeof(struct Candidate) * numCandidates);
+    job.alive = (int*) malloc(sizeof(int) * numCandidates);
+    job.results = (ReturnData*) malloc(sizeof(ReturnData) * (numCandidates * (long)OPTIMIZER_FIRST_ROUND + most));
+    if(job.candidates == NULL || job.alive == NULL || job.results == NULL){
+        free(job.candidates);
+        free(job.alive);
+        free(job.results);
+        return 1;
+    }
+    for(i = 0; i < numCandidates; i++){
+        SimConfig config = {search->arrivalRateLHS, search->minPeriod + i / side,
+                            search->arrivalRateRHS, search->minPeriod + i % side};
+        job.candidates[i].config = config;
+        stat_init(&job.candidates[i].objective);
+        results_init(&job.candidates[i].stats);
+        job.alive[i] = i;
+    }
+    job.options = options;
+    job.lanes = options->backend == BACKEND_SIMD && options->engine == ENGINE_TICK ? simd_lanes() : 1;
+    job.first = 0;
+    job.count = OPTIMIZER_FIRST_ROUND;
+
+    while(1){
+        /* run the round's replications of every surviving candidate */
+        job.batches = (job.count + job.lanes - 1) / job.lanes;
+        run_pool(numAlive * job.batches, options->threads, run_optimizer_task, &job);
+
+        /* fold them into each candidate in replication order, counting what they cost */
+        for(i = 0; i < numAlive; i++){
+            struct Candidate *c = &job.candidates[job.alive[i]];
+            ReturnData *results = job.results + i * job.count;
+            for(j = 0; j < job.count; j++){
+                if(results[j].status == 0){
+                    continue;
+                }
+                stat_add(&c->objective, get_objective(results[j], search->objective));
+                results_add(&c->stats, results[j]);
+                /* every replication runs the arrival iterations, plus the iterations clearing the longer queue */
+                totalTicks += ARRIVAL_ITERATIONS + 1 + (results[j].clearanceTimeLHS > results[j].clearanceTimeRHS
+                                                        ? results[j].clearanceTimeLHS : results[j].clearanceTimeRHS);
+                totalReplications++;
+            }
+        }
+        job.first += job.count;
+
+        /* rank the survivors, and drop those that are clearly worse than the best */
+        rank_candidates(job.candidates, job.alive, numAlive);
+        struct Candidate *best = &job.candidates[job.alive[0]];
+        double bound = best->objective.mean + stat_half_width(&best->objective);
+        int keep = 1;
+        while(keep < numAlive){
+            struct Candidate *c = &job.candidates[job.alive[keep]];
+            if(c->objective.mean - stat_half_width(&c->objective) > bound){
+                break;
+            }
+            keep++;
+        }
+        /* the next round doubles each survivor's replications, so halve the field to keep the rounds the same size */
+        if(keep > (numAlive + 1) / 2){
+            keep = (numAlive + 1) / 2;
+        }
+        if(keep == 1 || job.first * 2 > most){
+            break;
+        }
+        numAlive = keep;
+        job.count = job.first;
+    }
+
+    /* report the best few candidates, and what the search cost */
+    fprintf(out, "rank,lightPeriodLHS,lightPeriodRHS,objective,objectiveHalfWidth,replications,"
+                 "avgTimeLHS,avgTimeRHS,clearanceTimeLHS,clearanceTimeRHS\n");
+    for(i = 0; i < numAlive && i < 5; i++){
+        struct Candidate *c = &job.candidates[job.alive[i]];
+        ReturnData res = results_mean(&c->stats);
+        fprintf(out, "%d,%d,%d,%f,%f,%ld,%f,%f,%f,%f\n",
+                i + 1,
+                c->config.lightPeriodLHS,
+                c->config.lightPeriodRHS,
+                c->objective.mean,
+                stat_half_width(&c->objective),
+                c->objective.count,
+                res.avgTimeLHS,
+                res.avgTimeRHS,
+                res.clearanceTimeLHS,
+                res.clearanceTimeRHS);
+    }
+    fprintf(out, "# %d candidates, %ld replications, %.0f simulated ticks (%ld replications to run every candidate "
+                 "%ld times)\n",
+            numCandidates, totalReplications, totalTicks, numCandidates * job.first, job.first);
+
+    free(job.candidates);
+    free(job.alive);
+    free(job.results);
+    return 0;
+}
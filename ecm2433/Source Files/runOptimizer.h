@@ -0,0 +1,37 @@
+#ifndef ECM2433___CW_RUNOPTIMIZER_H
+#define ECM2433___CW_RUNOPTIMIZER_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimConfig and SimOptions structs */
+#include "runSimulations.h"
+
+/* The objectives the optimizer can minimise
+ * OBJECTIVE_WAIT - the average waiting time of every vehicle, the mean of avgTimeLHS and avgTimeRHS weighted by
+ *                  the number of vehicles from each side
+ * OBJECTIVE_CLEARANCE - the larger of clearanceTimeLHS and clearanceTimeRHS */
+#define OBJECTIVE_WAIT 0
+#define OBJECTIVE_CLEARANCE 1
+
+/* The replications every candidate gets in the first round, the survivors get twice as many each round after */
+#define OPTIMIZER_FIRST_ROUND 8
+
+/* The most replications a candidate is given when no --replications limit is passed in */
+#define MAX_OPTIMIZER_REPLICATIONS 1024
+
+/* The struct Search, aka SearchOptions, holds what the optimizer searches for
+ * int arrivalRateLHS, arrivalRateRHS - the fixed arrival rates
+ * int minPeriod, maxPeriod - every pair of light periods in this range is a candidate
+ * int objective - the OBJECTIVE_ to minimise */
+typedef struct Search {
+    int arrivalRateLHS;
+    int arrivalRateRHS;
+    int minPeriod;
+    int maxPeriod;
+    int objective;
+}SearchOptions;
+
+/* Declare the functions of runOptimizer.c */
+int find_objective(const char *name);
+int runOptimizer(SearchOptions *search, SimOptions *options, FILE *out);
+
+#endif
@@ -0,0 +1,486 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "runServer.h"
+
+/*
+ * runServer answers simulation requests from a long running process, keeping the result of every replication it has
+ * run in a cache so that repeated requests cost no simulation at all.
+ *
+ * Requests are read one per line, from stdin (answering on stdout) or from the connections to a Unix domain socket:
+ *     run arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [replications [seed]]
+ *     stats
+ *     shutdown
+ * run answers with one line
+ *     ok SOURCE REPLICATIONS avgTimeRHS HALFWIDTH maxTimeRHS HALFWIDTH ... clearanceTimeLHS HALFWIDTH
+ * giving the mean and 95% confidence interval half width of each ReturnData field in ReturnData order, where SOURCE is
+ * cached if every replication was already known, partial if only the missing ones were run, or computed. stats
+ * answers with the cache counters, and anything that goes wrong is answered with a line starting with error.
+ *
+ * The cache is keyed by the configuration, seed, engine and SIM_MODEL_VERSION, and holds the results of replications 0
+ * to count - 1 of each key, so a request for more replications than are cached only runs the rest. When a store file
+ * is given, every batch of new results is appended to it and the cache is loaded back from it on start up, cutting off
+ * any batch left half written when a server was stopped part way through saving it.
+ * The random streams are counter based, so there is no generator state to keep between requests.
+*/
+
+/*
+ * CacheKey is everything that decides the results of a replication
+*/
+struct CacheKey {
+    int arrivalRateLHS;
+    int lightPeriodLHS;
+    int arrivalRateRHS;
+    int lightPeriodRHS;
+    unsigned long seed;
+    int engine;
+    int version;
+};
+
+/*
+ * CacheEntry holds the results of replications 0 to count - 1 of one key, chained in its hash bucket
+*/
+struct CacheEntry {
+    struct CacheKey key;
+    ReturnData *results;
+    long count;
+    long capacity;
+    struct CacheEntry *next;
+};
+
+/*
+ * StoreRecord starts each batch of results in the store file, followed by count ReturnData structs
+*/
+struct StoreRecord {
+    int32_t arrivalRateLHS;
+    int32_t lightPeriodLHS;
+    int32_t arrivalRateRHS;
+    int32_t lightPeriodRHS;
+    int32_t engine;
+    int32_t version;
+    uint64_t seed;
+    int64_t first;
+    int64_t count;
+};
+
+/*
+ * Server is the state of a running server
+*/
+struct Server {
+    struct CacheEntry *buckets[CACHE_BUCKETS];
+    FILE *store;
+    SimOptions *options;
+    long hits;
+    long partials;
+    long misses;
+    long entries;
+};
+
+/*
+ * ServerJob is the worker pool job that runs the missing replications of an entry, task i runs replication first + i
+*/
+struct ServerJob {
+    struct CacheKey *key;
+    long first;
+    ReturnData *results;
+};
+
+/**
+ * hash_key works out the bucket of a key with the FNV-1a hash of its fields
+ * @param key - the key
+ * @return - the bucket index
+ */
+static unsigned long hash_key(const struct CacheKey *key){
+    unsigned long fields[7];
+    unsigned long hash = 2166136261UL;
+    int i, j;
+    fields[0] = (unsigned long)key->arrivalRateLHS;
+    fields[1] = (unsigned long)key->lightPeriodLHS;
+    fields[2] = (unsigned long)key->arrivalRateRHS;
+    fields[3] = (unsigned long)key->lightPeriodRHS;
+    fields[4] = key->seed;
+    fields[5] = (unsigned long)key->engine;
+    fields[6] = (unsigned long)key->version;
+    for(i = 0; i < 7; i++){
+        for(j = 0; j < (int)sizeof(unsigned long); j++){
+            hash ^= (fields[i] >> (8 * j)) & 0xff;
+            hash = (hash * 16777619UL) & 0xffffffffUL;
+        }
+    }
+    return hash % CACHE_BUCKETS;
+}
+
+/**
+ * find_entry finds the cache entry of a key, creating an empty one if there is none
+ * @param server - the server
+ * @param key - the key
+ * @return - pointer to the entry, or NULL if there was no memory for a new one
+ */
+static struct CacheEntry *find_entry(struct Server *server, const struct CacheKey *key){
+    unsigned long bucket = hash_key(key);
+    struct CacheEntry *entry;
+    for(entry = server->buckets[bucket]; entry != NULL; entry = entry->next){
+        if(memcmp(&entry->key, key, sizeof(*key)) == 0){
+            return entry;
+        }
+    }
+    entry = (struct CacheEntry*) calloc(1, sizeof(struct CacheEntry));
+    if(entry == NULL){
+        return NULL;
+    }
+    entry->key = *key;
+    entry->next = server->buckets[bucket];
+    server->buckets[bucket] = entry;
+    server->entries++;
+    return entry;
+}
+
+/**
+ * make_key fills in a key, clearing it first so that keys can be compared byte by byte
+ * @param key - the key to fill in
+ * @param config - the four simulation parameters, in the order of SimConfig
+ * @param seed - the master seed
+ * @param engine - the engine
+ * @param version - the model version
+ */
+static void make_key(struct CacheKey *key, const int *config, unsigned long seed, int engine, int version){
+    memset(key, 0, sizeof(*key));
+    key->arrivalRateLHS = config[0];
+    key->lightPeriodLHS = config[1];
+    key->arrivalRateRHS = config[2];
+    key->lightPeriodRHS = config[3];
+    key->seed = seed;
+    key->engine = engine;
+    key->version = version;
+}
+
+/**
+ * reserve_results makes sure an entry has space for count results
+ * @param entry - the entry
+ * @param count - the number of results it must hold
+ * @return - an integer to state whether this was successful(0) or not(1)
+ */
+static int reserve_results(struct CacheEntry *entry, long count){
+    if(count <= entry->capacity){
+        return 0;
+    }
+    long capacity = entry->capacity * 2 > count ? entry->capacity * 2 : count;
+    ReturnData *tmp = (ReturnData*) realloc(entry->results, sizeof(ReturnData) * capacity);
+    if(tmp == NULL){
+        return 1;
+    }
+    entry->results = tmp;
+    entry->capacity = capacity;
+    return 0;
+}
+
+/**
+ * load_store reads the results saved in the store file into the cache, skipping those of other model versions and
+ * any batch that does not follow on from what is already cached. Anything after the last complete batch is cut off
+ * the file, so that new batches are appended straight after it
+ * @param server - the server, with its store open for reading and appending
+ * @param storePath - the path of the store, for the message when the store is cut short
+ * @return - an integer to state whether the store could be read and cut back(0) or not(1)
+ */
+static int load_store(struct Server *server, const char *storePath){
+    struct StoreRecord record;
+    long size, complete = 0;
+    if(fseek(server->store, 0, SEEK_END) != 0 || (size = ftell(server->store)) < 0){
+        return 1;
+    }
+    rewind(server->store);
+    /* only read a batch once the file is known to hold all of it */
+    while(size - complete >= (long)sizeof(record) && fread(&record, sizeof(record), 1, server->store) == 1){
+        int config[4];
+        struct CacheKey key;
+        struct CacheEntry *entry = NULL;
+        if(record.count < 0 || record.count > MAX_ADAPTIVE_REPLICATIONS
+           || size - complete - (long)sizeof(record) < (long)sizeof(ReturnData) * record.count){
+            break;
+        }
+        config[0] = record.arrivalRateLHS;
+        config[1] = record.lightPeriodLHS;
+        config[2] = record.arrivalRateRHS;
+        config[3] = record.lightPeriodRHS;
+        make_key(&key, config, (unsigned long)record.seed, record.engine, record.version);
+        if(record.version == SIM_MODEL_VERSION){
+            entry = find_entry(server, &key);
+        }
+        if(entry != NULL && record.first == entry->count && reserve_results(entry, entry->count + record.count) == 0){
+            if(fread(entry->results + entry->count, sizeof(ReturnData), record.count, server->store)
+               != (size_t)record.count){
+                break;
+            }
+            entry->count += record.count;
+        }else if(fseek(server->store, (long)(sizeof(ReturnData) * record.count), SEEK_CUR) != 0){
+            break;
+        }
+        complete += (long)sizeof(record) + (long)sizeof(ReturnData) * record.count;
+    }
+    /* a batch cut short by a server that stopped while saving would have every later batch appended after it and
+     * be read as part of them, so cut the file back to the last complete batch */
+    if(complete < size){
+        fprintf(stderr, "cache store %s ends with %ld bytes of an incomplete batch, which are dropped\n",
+                storePath, size - complete);
+        if(fflush(server->store) != 0 || ftruncate(fileno(server->store), complete) != 0){
+            return 1;
+        }
+    }
+    /* new batches are appended after whatever was read */
+    return fseek(server->store, 0, SEEK_END) != 0;
+}
+
+/**
+ * save_results appends a batch of new results of an entry to the store file
+ * @param server - the server
+ * @param entry - the entry the results belong to
+ * @param first - the replication of the first result of the batch
+ * @param count - the number of results in the batch
+ */
+static void save_results(struct Server *server, struct CacheEntry *entry, long first, long count){
+    struct StoreRecord record;
+    if(server->store == NULL){
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    record.arrivalRateLHS = entry->key.arrivalRateLHS;
+    record.lightPeriodLHS = entry->key.lightPeriodLHS;
+    record.arrivalRateRHS = entry->key.arrivalRateRHS;
+    record.lightPeriodRHS = entry->key.lightPeriodRHS;
+    record.engine = entry->key.engine;
+    record.version = entry->key.version;
+    record.seed = entry->key.seed;
+    record.first = first;
+    record.count = count;
+    fwrite(&record, sizeof(record), 1, server->store);
+    fwrite(entry->results + first, sizeof(ReturnData), count, server->store);
+    fflush(server->store);
+}
+
+/**
+ * run_server_task is the worker pool task that runs one missing replication
+ * @param index - the index of the replication within the job
+ * @param arg - pointer to the ServerJob being run
+ */
+static void run_server_task(long index, void *arg){
+    struct ServerJob *job = (struct ServerJob*) arg;
+    job->results[index] = runOneSimulation(job->key->arrivalRateLHS, job->key->lightPeriodLHS,
+                                           job->key->arrivalRateRHS, job->key->lightPeriodRHS,
+                                           job->key->seed, job->first + index, job->key->engine, VARIATES_PLAIN);
+}
+
+/**
+ * handle_run answers a run request, running only the replications that are not cached
+ * @param server - the server
+ * @param args - the rest of the request line after "run"
+ * @param out - the stream to answer on
+ */
+static void handle_run(struct Server *server, char *args, FILE *out){
+    int config[4];
+    long replications = server->options->replications;
+    unsigned long seed = server->options->seed;
+    char extra[2][32];
+    int fields = sscanf(args, "%d %d %d %d %31s %31s", &config[0], &config[1], &config[2], &config[3],
+                        extra[0], extra[1]);
+    if(fields < 4){
+        fprintf(out, "error expected run arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS "
+                     "[replications [seed]]\n");
+        return;
+    }
+    if(fields > 4){
+        replications = atol(extra[0]);
+    }
+    if(fields > 5){
+        seed = strtoul(extra[1], NULL, 10);
+    }
+    /* a light period below 1 never lets a vehicle through, so the simulation would never finish */
+    if(config[1] < 1 || config[3] < 1 || replications < 1 || replications > MAX_ADAPTIVE_REPLICATIONS){
+        fprintf(out, "error light periods must be at least 1 and replications between 1 and %d\n",
+                MAX_ADAPTIVE_REPLICATIONS);
+        return;
+    }
+
+    struct CacheKey key;
+    make_key(&key, config, seed, server->options->engine, SIM_MODEL_VERSION);
+    struct CacheEntry *entry = find_entry(server, &key);
+    if(entry == NULL || reserve_results(entry, replications) == 1){
+        fprintf(out, "error out of memory\n");
+        return;
+    }
+
+    /* run whatever replications are missing, and remember them */
+    const char *source;
+    if(entry->count >= replications){
+        source = "cached";
+        server->hits++;
+    }else{
+        struct ServerJob job = {&entry->key, entry->count, entry->results + entry->count};
+        if(entry->count > 0){
+            source = "partial";
+            server->partials++;
+        }else{
+            source = "computed";
+            server->misses++;
+        }
+        run_pool(replications - entry->count, server->options->threads, run_server_task, &job);
+        save_results(server, entry, entry->count, replications - entry->count);
+        entry->count = replications;
+    }
+
+    /* combine the first replications in order, which gives the same answer as runSimulations */
+    ResultStats stats;
+    results_init(&stats);
+    long i;
+    for(i = 0; i < replications; i++){
+        results_add(&stats, entry->results[i]);
+    }
+    fprintf(out, "ok %s %ld", source, stats.metrics[0].count);
+    int metric;
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        fprintf(out, " %f %f", stats.metrics[metric].mean, stat_half_width(&stats.metrics[metric]));
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * serve_stream answers the requests of one stream until it ends, an answer can't be written or it asks the server to
+ * shut down
+ * @param server - the server
+ * @param in - the stream to read requests from
+ * @param out - the stream to answer on
+ * @return - 1 if the server was asked to shut down, 0 if not
+ */
+static int serve_stream(struct Server *server, FILE *in, FILE *out){
+    char line[SERVER_LINE_LENGTH];
+    while(fgets(line, sizeof(line), in) != NULL){
+        char *command = strtok(line, " \t\r\n");
+        if(command == NULL){
+            continue;
+        }
+        if(strcmp(command, "run") == 0){
+            char *args = strtok(NULL, "");
+            handle_run(server, args != NULL ? args : "", out);
+        }else if(strcmp(command, "stats") == 0){
+            fprintf(out, "ok entries %ld hits %ld partial %ld computed %ld\n",
+                    server->entries, server->hits, server->partials, server->misses);
+        }else if(strcmp(command, "shutdown") == 0){
+            fprintf(out, "ok shutting down\n");
+            fflush(out);
+            return 1;
+        }else{
+            fprintf(out, "error unknown command %s\n", command);
+        }
+        /* the other end has gone away, so there is no one left to answer */
+        if(fflush(out) != 0 || ferror(out)){
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * serve_socket accepts connections to a Unix domain socket one after another, answering the requests of each
+ * @param server - the server
+ * @param socketPath - the path to create the socket at, any old socket there is replaced
+ * @return - an integer to state whether the server ran(0) or the socket could not be made(1)
+ */
+static int serve_socket(struct Server *server, const char *socketPath){
+    struct sockaddr_un address;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0 || strlen(socketPath) >= sizeof(address.sun_path)){
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    unlink(socketPath);
+    if(bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0){
+        close(listener);
+        return 1;
+    }
+    int stop = 0;
+    while(stop == 0){
+        int connection = accept(listener, NULL, NULL);
+        if(connection < 0){
+            continue;
+        }
+        /* use separate streams for each direction, so the reads and writes do not get in each other's way */
+        int copy = dup(connection);
+        FILE *in = fdopen(connection, "r");
+        FILE *out = copy >= 0 ? fdopen(copy, "w") : NULL;
+        if(in != NULL && out != NULL){
+            stop = serve_stream(server, in, out);
+        }
+        if(in != NULL){
+            fclose(in);
+        }else{
+            close(connection);
+        }
+        if(out != NULL){
+            fclose(out);
+        }else if(copy >= 0){
+            close(copy);
+        }
+    }
+    close(listener);
+    unlink(socketPath);
+    return 0;
+}
+
+/**
+ * runServer runs the server, see the top of this file, until it is asked to shut down or its input ends
+ * @param socketPath - the Unix domain socket to listen on, or NULL to answer requests from stdin on stdout
+ * @param storePath - the file to keep the cache in between runs, or NULL to only cache in memory
+ * @param options - the default seed and replications of requests, and the engine and threads to use
+ * @return - an integer to state whether the server ran successfully(0) or not(1)
+ */
+int runServer(const char *socketPath, const char *storePath, SimOptions *options){
+    struct Server server;
+    int i, failed = 0;
+    memset(&server, 0, sizeof(server));
+    server.options = options;
+    /* a client that hangs up before reading its answer makes the write fail instead of killing the server */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* open the store for reading and appending, creating it if it does not exist */
+    if(storePath != NULL){
+        server.store = fopen(storePath, "a+b");
+        if(server.store == NULL){
+            fprintf(stderr, "could not open cache store %s\n", storePath);
+            return 1;
+        }
+        if(load_store(&server, storePath) == 1){
+            fprintf(stderr, "could not read cache store %s\n", storePath);
+            failed = 1;
+        }
+    }
+
+    if(failed == 0 && socketPath != NULL){
+        failed = serve_socket(&server, socketPath);
+        if(failed){
+            fprintf(stderr, "could not listen on %s\n", socketPath);
+        }
+    }else if(failed == 0){
+        serve_stream(&server, stdin, stdout);
+    }
+
+    /* free the cache */
+    for(i = 0; i < CACHE_BUCKETS; i++){
+        while(server.buckets[i] != NULL){
+            struct CacheEntry *next = server.buckets[i]->next;
+            free(server.buckets[i]->results);
+            free(server.buckets[i]);
+            server.buckets[i] = next;
+        }
+    }
+    if(server.store != NULL){
+        fclose(server.store);
+    }
+    return failed;
+}
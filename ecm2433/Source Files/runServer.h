@@ -0,0 +1,17 @@
+#ifndef ECM2433___CW_RUNSERVER_H
+#define ECM2433___CW_RUNSERVER_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimOptions struct */
+#include "runSimulations.h"
+
+/* The number of hash buckets of the result cache */
+#define CACHE_BUCKETS 4096
+
+/* The longest request line the server reads */
+#define SERVER_LINE_LENGTH 256
+
+/* Declare the functions of runServer.c */
+int runServer(const char *socketPath, const char *storePath, SimOptions *options);
+
+#endif
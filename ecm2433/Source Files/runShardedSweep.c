@@ -0,0 +1,405 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <signal.h>
+#include <sys/prctl.h>
+#endif
+#include "runShardedSweep.h"
+#include "runSweep.h"
+
+/*
+ * runShardedSweep runs a sweep over several worker processes that keep their results in a memory mapped store file,
+ * so a sweep that is killed part of the way through carries on from where it stopped when it is run again.
+ *
+ * The store is a StoreHeader followed by one StoreSlot per configuration of the sweep, in sweep order, and is made
+ * the first time the sweep is run. The coordinator forks the worker processes, which share the mapping: each worker
+ * claims the next SHARD_CHUNK configurations by bumping nextChunk atomically, runs the ones whose slot is not done yet
+ * over its own --threads threads, and writes each result straight into its slot before marking the slot done.
+ * The pages of the mapping belong to the file rather than the workers, so the finished slots survive a worker (or the
+ * whole run) being killed. When a worker dies, the configurations of the chunk it held are run by another round of
+ * workers, and a store reopened by a later run skips every slot that is already done. Once every slot is done, the
+ * CSV rows of runSweep are written from the store in sweep order.
+ *
+ * The coordinator holds a write lock on the store for as long as it runs, so two runs can't share a store, and the
+ * workers never outlive it: on Linux they are killed when it dies, and elsewhere they stop before their next chunk.
+ *
+ * Each worker is a separate process with its own queues and result buffers, which are first touched after the fork,
+ * so the operating system is free to place every worker and its memory on whichever NUMA node it likes.
+*/
+
+/* The magic bytes at the start of a store file */
+#define STORE_MAGIC "SIMSWEEP"
+
+/*
+ * StoreHeader starts the store file, everything but nextChunk must match for a store to be reused
+ * uint64_t fingerprint - the FNV-1a hash of the configurations of the sweep, in order
+ * int64_t nextChunk - the next chunk of configurations to be claimed, set back to 0 at the start of every round
+*/
+struct StoreHeader {
+    char magic[8];
+    int32_t version;
+    int32_t engine;
+    uint64_t seed;
+    int64_t replications;
+    int64_t numConfigs;
+    uint64_t fingerprint;
+    int64_t slotSize;
+    int64_t nextChunk;
+};
+
+/*
+ * StoreSlot holds the configuration and combined result of one configuration of the sweep, done is only set once the
+ * result has been written
+*/
+struct StoreSlot {
+    SimConfig config;
+    int32_t done;
+    ReturnData result;
+};
+
+/*
+ * Store is a mapped store file
+ * int fd - the open store file, which holds the coordinator's lock on it until it is closed
+*/
+struct Store {
+    struct StoreHeader *header;
+    struct StoreSlot *slots;
+    size_t size;
+    int fd;
+};
+
+/*
+ * ShardJob is the worker pool job of the configurations of a chunk that still have to be run
+ * Task i of the pool runs batch (i % batches) of the configuration in slot index[i / batches], see run_sweep_batch
+*/
+struct ShardJob {
+    struct StoreSlot *slots;
+    long index[SHARD_CHUNK];
+    SimOptions *options;
+    int lanes;
+    long batches;
+    ReturnData *results;
+};
+
+/**
+ * fingerprint_configs works out the FNV-1a hash of the configurations of a sweep
+ * @param configs - the configurations
+ * @param count - the number of configurations
+ * @return - the 64 bit hash
+ */
+static uint64_t fingerprint_configs(SimConfig *configs, long count){
+    uint64_t hash = 14695981039346656037ULL;
+    long i;
+    int j, k;
+    for(i = 0; i < count; i++){
+        int32_t fields[4];
+        fields[0] = configs[i].arrivalRateLHS;
+        fields[1] = configs[i].lightPeriodLHS;
+        fields[2] = configs[i].arrivalRateRHS;
+        fields[3] = configs[i].lightPeriodRHS;
+        for(j = 0; j < 4; j++){
+            for(k = 0; k < 4; k++){
+                hash ^= ((uint32_t)fields[j] >> (8 * k)) & 0xff;
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+/**
+ * open_store locks and maps the store file of a sweep, making it if it doesn't exist yet
+ * @param path - the path of the store file
+ * @param configs - the configurations of the sweep
+ * @param count - the number of configurations
+ * @param options - the seed, engine and replications of the sweep
+ * @param store - set to the mapping of the store
+ * @return - an integer to state whether the store was opened(0) or not(1)
+ */
+static int open_store(const char *path, SimConfig *configs, long count, SimOptions *options, struct Store *store){
+    struct StoreHeader expected;
+    struct stat info;
+    long i;
+    memset(&expected, 0, sizeof(expected));
+    memcpy(expected.magic, STORE_MAGIC, sizeof(expected.magic));
+    expected.version = SIM_MODEL_VERSION;
+    expected.engine = options->engine;
+    expected.seed = options->seed;
+    expected.replications = options->replications;
+    expected.numConfigs = count;
+    expected.fingerprint = fingerprint_configs(configs, count);
+    expected.slotSize = sizeof(struct StoreSlot);
+    store->size = sizeof(struct StoreHeader) + sizeof(struct StoreSlot) * (size_t)count;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0){
+        fprintf(stderr, "could not open store %s\n", path);
+        return 1;
+    }
+    /* the lock belongs to this process only, so it is not passed on to the workers and goes when this process does */
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if(fcntl(fd, F_SETLK, &lock) != 0){
+        fprintf(stderr, "store %s is being used by another sweep\n", path);
+        close(fd);
+        return 1;
+    }
+    /* a new (empty) file is sized to hold every slot, which start out zeroed and so not done */
+    int created = fstat(fd, &info) == 0 && info.st_size == 0;
+    if(created && ftruncate(fd, (off_t)store->size) != 0){
+        fprintf(stderr, "could not make store %s\n", path);
+        close(fd);
+        return 1;
+    }
+    if(created == 0 && (fstat(fd, &info) != 0 || (size_t)info.st_size != store->size)){
+        fprintf(stderr, "store %s was made for a different sweep\n", path);
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, store->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED){
+        fprintf(stderr, "could not map store %s\n", path);
+        close(fd);
+        return 1;
+    }
+    store->fd = fd;
+    store->header = (struct StoreHeader*) map;
+    store->slots = (struct StoreSlot*) ((char*) map + sizeof(struct StoreHeader));
+
+    if(created){
+        for(i = 0; i < count; i++){
+            store->slots[i].config = configs[i];
+        }
+        *store->header = expected;
+        return 0;
+    }
+    /* a store can only be reused by the same sweep, run with the same settings and model */
+    expected.nextChunk = store->header->nextChunk;
+    if(memcmp(store->header, &expected, sizeof(expected)) != 0){
+        fprintf(stderr, "store %s was made for a different sweep, seed, engine or number of replications\n", path);
+        munmap(map, store->size);
+        close(fd);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * count_missing counts the configurations of a store that are not done yet
+ * @param store - the store
+ * @return - the number of slots that are not done
+ */
+static long count_missing(struct Store *store){
+    long missing = 0;
+    long i;
+    for(i = 0; i < store->header->numConfigs; i++){
+        missing += store->slots[i].done == 0;
+    }
+    return missing;
+}
+
+/**
+ * run_shard_task is the worker pool task that runs one batch of replications of one configuration of a chunk
+ * @param index - the task index, see ShardJob
+ * @param arg - pointer to the ShardJob being run
+ */
+static void run_shard_task(long index, void *arg){
+    struct ShardJob *job = (struct ShardJob*) arg;
+    long position = index / job->batches;
+    run_sweep_batch(&job->slots[job->index[position]].config, job->options, job->lanes, index % job->batches,
+                    job->results + position * job->options->replications);
+}
+
+/**
+ * run_worker is the body of a worker process, it claims chunks of the store until there are none left
+ * @param store - the store, mapped by the coordinator before the fork
+ * @param options - the seed, engine, threads and replications of the sweep
+ * @param coordinator - the process id of the coordinator
+ * @return - an integer to state whether the worker was successful(0) or not(1)
+ */
+static int run_worker(struct Store *store, SimOptions *options, pid_t coordinator){
+    struct ShardJob job;
+    long numConfigs = store->header->numConfigs;
+    long i;
+    job.slots = store->slots;
+    job.options = options;
+    job.lanes = sweep_lanes(options);
+    job.batches = (options->replications + job.lanes - 1) / job.lanes;
+    job.results = (ReturnData*) malloc(sizeof(ReturnData) * SHARD_CHUNK * options->replications);
+    if(job.results == NULL){
+        return 1;
+    }
+    while(1){
+        /* once the coordinator has gone, its lock on the store has too, so leave the store to whoever takes it next */
+        if(getppid() != coordinator){
+            free(job.results);
+            return 1;
+        }
+        long first = (long)__sync_fetch_and_add(&store->header->nextChunk, 1) * SHARD_CHUNK;
+        int count = 0;
+        if(first >= numConfigs){
+            break;
+        }
+        /* only run the configurations of the chunk that an earlier run didn't finish */
+        for(i = first; i < first + SHARD_CHUNK && i < numConfigs; i++){
+            if(store->slots[i].done == 0){
+                job.index[count++] = i;
+            }
+        }
+        if(count == 0){
+            continue;
+        }
+        run_pool((long)count * job.batches, options->threads, run_shard_task, &job);
+        for(i = 0; i < count; i++){
+            struct StoreSlot *slot = &store->slots[job.index[i]];
+            slot->result = combine_results(job.results + i * options->replications, (int)options->replications);
+            /* the result must be in the slot before the slot is marked done */
+            __sync_synchronize();
+            slot->done = 1;
+        }
+    }
+    free(job.results);
+    return 0;
+}
+
+/**
+ * run_round forks the worker processes and waits for all of them to finish
+ * @param store - the store
+ * @param processes - the number of worker processes to fork
+ * @param options - the seed, engine, threads and replications of the sweep
+ * @return - the number of workers that died or could not be started
+ */
+static int run_round(struct Store *store, int processes, SimOptions *options){
+    pid_t *workers = (pid_t*) malloc(sizeof(pid_t) * processes);
+    int started = 0, failed = 0;
+    int i;
+    pid_t coordinator = getpid();
+    if(workers == NULL){
+        return processes;
+    }
+    store->header->nextChunk = 0;
+    /* anything buffered would otherwise be written out again by every worker */
+    fflush(stdout);
+    fflush(stderr);
+    for(i = 0; i < processes; i++){
+        pid_t pid = fork();
+        if(pid == 0){
+#ifdef __linux__
+            /* have the worker killed if the coordinator dies, rather than carry on writing to the store */
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+            _exit(run_worker(store, options, coordinator));
+        }
+        if(pid < 0){
+            failed += processes - i;
+            break;
+        }
+        workers[started++] = pid;
+    }
+    for(i = 0; i < started; i++){
+        int status;
+        while(waitpid(workers[i], &status, 0) < 0){
+            if(errno != EINTR){
+                status = -1;
+                break;
+            }
+        }
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            failed++;
+        }
+    }
+    free(workers);
+    return failed;
+}
+
+/**
+ * read_store_seed reads the seed of an existing store, so that a resumed sweep carries on with the seed it was
+ * started with when no seed is given
+ * @param storePath - the path of the store file
+ * @param seed - set to the seed of the store
+ * @return - an integer to state whether the seed was read(0) or there is no valid store(1)
+ */
+int read_store_seed(const char *storePath, unsigned long *seed){
+    struct StoreHeader header;
+    FILE *file = fopen(storePath, "rb");
+    if(file == NULL){
+        return 1;
+    }
+    int valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, STORE_MAGIC, 8) == 0;
+    fclose(file);
+    if(valid == 0){
+        return 1;
+    }
+    *seed = (unsigned long)header.seed;
+    return 0;
+}
+
+/**
+ * runShardedSweep reads configurations from in, runs the ones that are not yet done in the store over a number of
+ * worker processes, see the top of this file, and writes the CSV rows of every configuration to out once all are done
+ * @param in - the stream to read the configurations from, in the format of runSweep
+ * @param out - the stream to write the CSV rows to
+ * @param storePath - the path of the store file, which is made if it doesn't exist
+ * @param processes - the number of worker processes
+ * @param options - the seed, engine, threads (per worker) and replications to use
+ * @return - an integer to state whether the sweep was successful(0) or not(1)
+ */
+int runShardedSweep(FILE *in, FILE *out, const char *storePath, int processes, SimOptions *options){
+    SimConfig *configs;
+    long count, i;
+    struct Store store;
+    int round;
+
+    if(read_sweep(in, &configs, &count) == 1){
+        return 1;
+    }
+    int failed = open_store(storePath, configs, count, options, &store);
+    free(configs);
+    if(failed){
+        return 1;
+    }
+
+    long missing = count_missing(&store);
+    if(missing < count){
+        fprintf(stderr, "resuming from %s, %ld of %ld configurations are already done\n", storePath, count - missing,
+                count);
+    }
+    /* run rounds of workers until every slot is done, or a round makes no progress */
+    for(round = 0; missing > 0 && round < SHARD_MAX_ROUNDS; round++){
+        int died = run_round(&store, processes, options);
+        long left = count_missing(&store);
+        if(left > 0){
+            fprintf(stderr, "%d worker processes failed, %ld configurations are left\n", died, left);
+        }
+        if(left == missing){
+            break;
+        }
+        missing = left;
+    }
+
+    if(missing > 0){
+        fprintf(stderr, "%ld configurations are not done, run the sweep again with the same store to finish them\n",
+                missing);
+        failed = 1;
+    }else{
+        write_sweep_header(out);
+        for(i = 0; i < count; i++){
+            write_sweep_row(out, i, &store.slots[i].config, store.slots[i].result);
+        }
+    }
+    msync(store.header, store.size, MS_SYNC);
+    munmap(store.header, store.size);
+    close(store.fd);
+    return failed;
+}
@@ -0,0 +1,18 @@
+#ifndef ECM2433___CW_RUNSHARDEDSWEEP_H
+#define ECM2433___CW_RUNSHARDEDSWEEP_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimConfig and SimOptions structs */
+#include "runSimulations.h"
+
+/* The number of configurations a worker process claims from the store at a time */
+#define SHARD_CHUNK 64
+
+/* The times the worker processes are started again to finish the configurations left by workers that died */
+#define SHARD_MAX_ROUNDS 3
+
+/* Declare the functions of runShardedSweep.c */
+int runShardedSweep(FILE *in, FILE *out, const char *storePath, int processes, SimOptions *options);
+int read_store_seed(const char *storePath, unsigned long *seed);
+
+#endif
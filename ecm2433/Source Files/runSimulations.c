@@ -1,34 +1,26 @@
 /* Include the required files */
 #include "runSimulations.h"
+#include "runSweep.h"
+#include "runNetwork.h"
+#include "runOptimizer.h"
+#include "runCompare.h"
+#include "simTrace.h"
+#include "runSteadyState.h"
+#include "runServer.h"
+#include "runShardedSweep.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
+#include <sys/time.h>
 
 /**
- * Updates the averages of the res variable using the new values of the tmp variable
- * @param res - pointer to a ReturnData structure which holds the averaged results so far
- * @param tmp - ReturnData structure which holds the most recent results to be added to the average stored in res
+ * Displays the waiting time percentiles of one light to the stdout stream
+ * @param histogram - The histogram of the waiting times of every vehicle at the light
  */
-void update_res(ReturnData *res, ReturnData tmp){
-    /* calculate the new average for the average waiting time in the right light and store it to the res struct  */
-    res->avgTimeRHS = (res->avgTimeRHS + tmp.avgTimeRHS)/2;
-    /* calculate the new average for the maximum waiting time in the right light and store it to the res struct  */
-    res->maxTimeRHS = (res->maxTimeRHS + tmp.maxTimeRHS)/2;
-    /* calculate the new average for the total number of vehicles in the right light and store it to the res struct  */
-    res->numOfVehiclesRHS = (res->numOfVehiclesRHS + tmp.numOfVehiclesRHS)/2;
-    /* calculate the new average for the clearance time of the right light and store it to the res struct  */
-    res->clearanceTimeRHS = (res->clearanceTimeRHS + tmp.clearanceTimeRHS)/2;
-
-    /* calculate the new average for the average waiting time in the left light and store it to the res struct  */
-    res->avgTimeLHS = (res->avgTimeLHS + tmp.avgTimeLHS)/2;
-    /* calculate the new average for the maximum waiting time in the left light and store it to the res struct  */
-    res->maxTimeLHS = (res->maxTimeLHS + tmp.maxTimeLHS)/2;
-    /* calculate the new average for the total number of vehicles in the left light and store it to the res struct  */
-    res->numOfVehiclesLHS = (res->numOfVehiclesLHS + tmp.numOfVehiclesLHS)/2;
-    /* calculate the new average for the clearance time of the left light and store it to the res struct  */
-    res->clearanceTimeLHS = (res->clearanceTimeLHS + tmp.clearanceTimeLHS)/2;
+static void display_percentiles(const WaitHistogram *histogram){
+    printf("        waiting time percentiles: p50 %d, p90 %d, p99 %d, p99.9 %d\n",
+           histogram_percentile(histogram, 50), histogram_percentile(histogram, 90),
+           histogram_percentile(histogram, 99), histogram_percentile(histogram, 99.9));
 }
 
 /**
@@ -37,13 +29,19 @@ void update_res(ReturnData *res, ReturnData tmp){
  * @param lightPeriodLHS - The period that the Left light stays active for (an integer for the number of iterations)
  * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
  * @param lightPeriodRHS - The period that the Left light stays active for (an integer for the number of iterations)
- * @param res - The averaged result over the 100 calls of the runOneSimulation function
+ * @param seed - The master seed used for the runs, so that they can be replayed
+ * @param stats - The statistics of the calls of the runOneSimulation function
+ * @param waits - The histograms of the waiting times of every vehicle of those calls, whose percentiles are shown
+ *                when it is not NULL
  */
 void display(int arrivalRateLHS,
              int lightPeriodLHS,
              int arrivalRateRHS,
              int lightPeriodRHS,
-             ReturnData res){
+             unsigned long seed,
+             ResultStats *stats,
+             WaitHistograms *waits){
+    const RunningStat *m = stats->metrics;
     printf("Parameter Values:\n"
            "    from left:\n"
            "        traffic arrival rate: %d\n"
@@ -51,83 +49,508 @@ void display(int arrivalRateLHS,
            "    from right:\n"
            "        traffic arrival rate: %d\n"
            "        traffic light period %d\n"
-           "Results (averaged over 100 runs):\n"
+           "    random seed: %lu\n"
+           "Results (averaged over %ld runs, with 95%% confidence intervals):\n"
            "    from left:\n"
-           "        number of vehicles: %f\n"
-           "        average waiting time: %f\n"
-           "        maximum waiting time: %f\n"
-           "        clearance time: %f\n"
-           "    from right:\n"
-           "        number of vehicles: %f\n"
-           "        average waiting time: %f\n"
-           "        maximum waiting time: %f\n"
-           "        clearance time: %f\n",
+           "        number of vehicles: %f +/- %f\n"
+           "        average waiting time: %f +/- %f\n"
+           "        maximum waiting time: %f +/- %f\n"
+           "        clearance time: %f +/- %f\n",
            arrivalRateLHS,
            lightPeriodLHS,
            arrivalRateRHS,
            lightPeriodRHS,
-           res.numOfVehiclesLHS,
-           res.avgTimeLHS,
-           res.maxTimeLHS,
-           res.clearanceTimeLHS,
-           res.numOfVehiclesRHS,
-           res.avgTimeRHS,
-           res.maxTimeRHS,
-           res.clearanceTimeRHS);
+           seed,
+           m[METRIC_AVG_TIME_LHS].count,
+           m[METRIC_NUM_OF_VEHICLES_LHS].mean, stat_half_width(&m[METRIC_NUM_OF_VEHICLES_LHS]),
+           m[METRIC_AVG_TIME_LHS].mean, stat_half_width(&m[METRIC_AVG_TIME_LHS]),
+           m[METRIC_MAX_TIME_LHS].mean, stat_half_width(&m[METRIC_MAX_TIME_LHS]),
+           m[METRIC_CLEARANCE_TIME_LHS].mean, stat_half_width(&m[METRIC_CLEARANCE_TIME_LHS]));
+    if(waits != NULL){
+        display_percentiles(&waits->side[HISTOGRAM_LHS]);
+    }
+    printf("    from right:\n"
+           "        number of vehicles: %f +/- %f\n"
+           "        average waiting time: %f +/- %f\n"
+           "        maximum waiting time: %f +/- %f\n"
+           "        clearance time: %f +/- %f\n",
+           m[METRIC_NUM_OF_VEHICLES_RHS].mean, stat_half_width(&m[METRIC_NUM_OF_VEHICLES_RHS]),
+           m[METRIC_AVG_TIME_RHS].mean, stat_half_width(&m[METRIC_AVG_TIME_RHS]),
+           m[METRIC_MAX_TIME_RHS].mean, stat_half_width(&m[METRIC_MAX_TIME_RHS]),
+           m[METRIC_CLEARANCE_TIME_RHS].mean, stat_half_width(&m[METRIC_CLEARANCE_TIME_RHS]));
+    if(waits != NULL){
+        display_percentiles(&waits->side[HISTOGRAM_RHS]);
+    }
+}
+
+/**
+ * Combines the results of a set of replications, in replication order, into a single averaged result
+ * @param results - array of the results of each replication
+ * @param count - the number of results in the array
+ * @return - the averaged ReturnData struct
+ */
+ReturnData combine_results(ReturnData *results, int count){
+    ResultStats stats;
+    results_init(&stats);
+    int test_no;
+    for(test_no = 0; test_no < count; test_no++){
+        /* results with the status 0 had an error, and are discarded by results_add */
+        results_add(&stats, results[test_no]);
+    }
+    return results_mean(&stats);
+}
+
+/*
+ * ReplicationJob holds everything a worker needs to run one replication and where to store its result
+*/
+struct ReplicationJob {
+    int arrivalRateLHS;
+    int lightPeriodLHS;
+    int arrivalRateRHS;
+    int lightPeriodRHS;
+    unsigned long seed;
+    int engine;
+    int lanes;
+    long first;
+    long count;
+    ReturnData *results;
+};
+
+/**
+ * run_replication is the worker pool task that runs a single replication and stores it in its own result slot
+ * @param index - the index of the replication within the job, replication first + index is run
+ * @param arg - pointer to the ReplicationJob being run
+ */
+void run_replication(long index, void *arg){
+    struct ReplicationJob *job = (struct ReplicationJob*) arg;
+    job->results[index] = runOneSimulation(job->arrivalRateLHS, job->lightPeriodLHS,
+                                           job->arrivalRateRHS, job->lightPeriodRHS,
+                                           job->seed, job->first + index, job->engine, VARIATES_PLAIN);
 }
 
 /**
- * Runs the runOneSimulation function 100 times using the input passed into this function, returns the averaged results
+ * run_simd_batch is the worker pool task of the SIMD backend, which runs one batch of replications side by side
+ * @param index - the batch number, batch i runs the job's replications from i * lanes onwards
+ * @param arg - pointer to the ReplicationJob being run
+ */
+void run_simd_batch(long index, void *arg){
+    struct ReplicationJob *job = (struct ReplicationJob*) arg;
+    long offset = index * job->lanes;
+    int count = job->count - offset < job->lanes ? (int)(job->count - offset) : job->lanes;
+    runSimdBatch(job->arrivalRateLHS, job->lightPeriodLHS, job->arrivalRateRHS, job->lightPeriodRHS,
+                 job->seed, job->first + offset, count, job->results + offset);
+}
+
+/**
+ * Runs the runOneSimulation function options->replications times using the input passed into this function, returns
+ * the averaged results
+ * The replications are spread over options->threads workers, but the results are always combined in replication
+ * order, so the result is the same whatever the number of threads
+ * If options->metric is set, the replications are run in rounds of ADAPTIVE_ROUND and stop as soon as the 95%
+ * confidence interval half width of that metric is below options->target (options->replications is then the most
+ * that will be run)
  * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
  * @param lightPeriodLHS - The period that the Left light stays active for (an integer for the number of iterations)
  * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
  * @param lightPeriodRHS - The period that the Left light stays active for (an integer for the number of iterations)
- * @return - A ReturnData struct to hold all relevant data required by the calling function
+ * @param options - The seed, engine, backend, number of threads and replications to use
+ * @param stats - Receives the statistics of every field over the replications, can be NULL
+ * @param waits - Receives the histograms of the waiting times of every vehicle of every replication, which are only
+ *                recorded when this is not NULL
+ * @return - A ReturnData struct to hold all relevant data required by the calling function, with the status 0 if no
+ *           replication ran or the waiting times of some vehicles could not be recorded
  */
-ReturnData runSimulations(int arrivalRateLHS, int lightPeriodLHS, int arrivalRateRHS, int lightPeriodRHS){
-    /* calls the function once to get the initial ResultData struct */
-    ReturnData res = runOneSimulation(arrivalRateLHS, lightPeriodLHS, arrivalRateRHS, lightPeriodRHS);
-
-    /* for another 100 times, do the code below */
-    int test_no = 2;
-    while(test_no<=100){
-        /* increment the test_no counter */
-        test_no++;
-        /* call runOneSimulation once and store the result in tmp*/
-        ReturnData tmp = runOneSimulation(arrivalRateLHS, lightPeriodLHS, arrivalRateRHS, lightPeriodRHS);
-        /* if the status of the result is 0, an error occurred, so discard this run */
-        if(tmp.status == 0){
-                continue;
+ReturnData runSimulations(int arrivalRateLHS, int lightPeriodLHS, int arrivalRateRHS, int lightPeriodRHS,
+                          SimOptions *options, ResultStats *stats, WaitHistograms *waits){
+    /* the replications are run all at once, or a round at a time when stopping adaptively */
+    long round = options->replications;
+    if(options->metric >= 0 && round > ADAPTIVE_ROUND){
+        round = ADAPTIVE_ROUND;
+    }
+
+    /* malloc the space for the result of every replication of a round */
+    ReturnData *results = (ReturnData*) malloc(sizeof(ReturnData) * round);
+    /* check that this malloc was successful */
+    if (results == NULL) {
+        /* if the malloc is unsuccessful, then return an empty ReturnData instance with the status 0 */
+        ReturnData tmp = {0,0,0,0,0,0,0,0,0};
+        return tmp;
+    }
+
+    struct ReplicationJob job = {arrivalRateLHS, lightPeriodLHS, arrivalRateRHS, lightPeriodRHS, options->seed, options->engine,
+                              1, 0, 0, results};
+    ResultStats total;
+    results_init(&total);
+    /* each thread records into its own histograms, which are merged as the threads finish */
+    if(waits != NULL){
+        histogram_record_start();
+    }
+    while(job.first < options->replications){
+        job.count = options->replications - job.first < round ? options->replications - job.first : round;
+
+        /* run every replication of the round in the worker pool, each one writing to its own slot of results */
+        if(options->backend == BACKEND_SIMD && options->engine == ENGINE_TICK){
+            /* the SIMD backend hands out batches of replications instead, which give the same results */
+            job.lanes = simd_lanes();
+            run_pool((job.count + job.lanes - 1) / job.lanes, options->threads, run_simd_batch, &job);
+        }else{
+            run_pool(job.count, options->threads, run_replication, &job);
+        }
+
+        /* combine the round's replications in order, then merge them into the total */
+        ResultStats part;
+        results_init(&part);
+        long test_no;
+        for(test_no = 0; test_no < job.count; test_no++){
+            results_add(&part, results[test_no]);
+        }
+        results_merge(&total, &part);
+        job.first += job.count;
+
+        /* stop once the chosen metric is known precisely enough */
+        if(options->metric >= 0 && stat_half_width(&total.metrics[options->metric]) < options->target){
+            break;
         }
-        /* as we didn't discard this run, update the overall res using the new tmp variable and initial res */
-        update_res(&res, tmp);
     }
 
-    /* once complete, res can be returned */
-    return res;
+    /* once complete, the results can be freed and the means returned */
+    free(results);
+    ReturnData mean = results_mean(&total);
+    if(waits != NULL && histogram_record_finish(waits) == 1){
+        mean.status = 0;
+    }
+    if(stats != NULL){
+        *stats = total;
+    }
+    return mean;
 }
 
+/* main is left out when runSimulations.c is built into other programs, such as the benchmarks, with -DSIM_LIBRARY */
+#ifndef SIM_LIBRARY
+
 /**
  * Main function to handle incoming inputs and call the runSimulations function
+ * Usage: runSimulations arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [seed] [options]
+ *    or: runSimulations --sweep FILE [seed] [options]
  * @param argc - number of arguements being passed in (this param does not need to be passed in by the user)
- * @param argv - array of parameters passed in by the user in the command line
+ * @param argv - array of parameters passed in by the user in the command line, an optional 5th parameter sets the
+ *               seed, --threads N sets the number of worker threads (0 uses every core), --engine chooses
+ *               the tick by tick engine (the default) or the next event engine, --simd runs the tick engine's
+ *               replications in vector lanes (with the same results), --replications N sets the number of
+ *               replications, --target METRIC HALFWIDTH stops once the 95% confidence interval of a ReturnData
+ *               field of a plain run is narrower than HALFWIDTH and --sweep FILE runs
+ *               every configuration listed in FILE ('-' for stdin) and writes CSV rows to stdout, with --store STORE
+ *               it runs over --processes N worker processes keeping its results in STORE, so it can be resumed
  * @return - integer to show successful or errors in the run
  */
 int main(int argc, char *argv[]){
 
-    /* call the runSimulations function with the passed in inputs in integer format */
-    ReturnData dat = runSimulations(atoi(argv[1]),
-                                    atoi(argv[2]),
-                                    atoi(argv[3]),
-                                    atoi(argv[4]));
+    /* separate the --threads option from the positional parameters */
+    SimOptions options = {0, 1, ENGINE_TICK, BACKEND_SCALAR, NUM_REPLICATIONS, -1, 0};
+    int replicationsSet = 0;
+    char *params[5] = {NULL, NULL, NULL, NULL, NULL};
+    char *sweepFile = NULL;
+    char *networkFile = NULL;
+    SearchOptions search = {0, 0, 1, 20, -1};
+    SimConfig compareWith;
+    int compare = 0;
+    int variates = VARIATES_SYNCED;
+    char *traceFile = NULL;
+    long steadyTicks = 0;
+    long batchSize = STEADY_BATCH_SIZE;
+    int serve = 0;
+    char *socketPath = NULL;
+    char *storePath = NULL;
+    char *shardStore = NULL;
+    int processes = 1;
+    int percentiles = 0;
+    int numParams = 0;
+    int i;
+    for(i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            options.threads = atoi(argv[++i]);
+        }else if(strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+            /* choose between the tick by tick engine and the next event engine */
+            i++;
+            if(strcmp(argv[i], "event") == 0){
+                options.engine = ENGINE_EVENT;
+            }else if(strcmp(argv[i], "tick") == 0){
+                options.engine = ENGINE_TICK;
+            }else{
+                fprintf(stderr, "unknown engine %s, expected tick or event\n", argv[i]);
+                return 0;
+            }
+        }else if(strcmp(argv[i], "--simd") == 0){
+            /* run the tick engine's replications side by side in vector lanes */
+            options.backend = BACKEND_SIMD;
+        }else if(strcmp(argv[i], "--replications") == 0 && i + 1 < argc){
+            options.replications = atol(argv[++i]);
+            replicationsSet = 1;
+        }else if(strcmp(argv[i], "--target") == 0 && i + 2 < argc){
+            /* stop once the confidence interval of the named ReturnData field is narrow enough */
+            options.metric = find_metric(argv[++i]);
+            options.target = atof(argv[++i]);
+            if(options.metric < 0){
+                fprintf(stderr, "unknown metric %s, expected a ReturnData field such as avgTimeLHS\n", argv[i - 1]);
+                return 0;
+            }
+        }else if(strcmp(argv[i], "--sweep") == 0 && i + 1 < argc){
+            sweepFile = argv[++i];
+        }else if(strcmp(argv[i], "--network") == 0 && i + 1 < argc){
+            networkFile = argv[++i];
+        }else if(strcmp(argv[i], "--optimize") == 0 && i + 1 < argc){
+            /* search for the light periods that minimise an objective */
+            search.objective = find_objective(argv[++i]);
+            if(search.objective < 0){
+                fprintf(stderr, "unknown objective %s, expected wait or clearance\n", argv[i]);
+                return 0;
+            }
+        }else if(strcmp(argv[i], "--compare") == 0 && i + 4 < argc){
+            /* compare the configuration of the positional parameters with this one, using common random numbers */
+            compareWith.arrivalRateLHS = atoi(argv[++i]);
+            compareWith.lightPeriodLHS = atoi(argv[++i]);
+            compareWith.arrivalRateRHS = atoi(argv[++i]);
+            compareWith.lightPeriodRHS = atoi(argv[++i]);
+            compare = 1;
+        }else if(strcmp(argv[i], "--percentiles") == 0){
+            /* record the waiting time of every vehicle, to show the waiting time percentiles of each light */
+            percentiles = 1;
+        }else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+            /* record every vehicle to a binary trace file, read with traceReader */
+            traceFile = argv[++i];
+        }else if(strcmp(argv[i], "--steady-state") == 0 && i + 1 < argc){
+            /* run one long simulation and estimate its steady state by batch means */
+            steadyTicks = atol(argv[++i]);
+        }else if(strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc){
+            batchSize = atol(argv[++i]);
+        }else if(strcmp(argv[i], "--serve") == 0){
+            /* answer requests from stdin, or from a Unix domain socket with --socket */
+            serve = 1;
+        }else if(strcmp(argv[i], "--socket") == 0 && i + 1 < argc){
+            socketPath = argv[++i];
+        }else if(strcmp(argv[i], "--cache") == 0 && i + 1 < argc){
+            storePath = argv[++i];
+        }else if(strcmp(argv[i], "--store") == 0 && i + 1 < argc){
+            /* keep the results of a sweep in a store file, so a sweep that is stopped can be resumed */
+            shardStore = argv[++i];
+        }else if(strcmp(argv[i], "--processes") == 0 && i + 1 < argc){
+            processes = atoi(argv[++i]);
+        }else if(strcmp(argv[i], "--antithetic") == 0){
+            variates |= VARIATES_ANTITHETIC;
+        }else if(strcmp(argv[i], "--periods") == 0 && i + 2 < argc){
+            search.minPeriod = atoi(argv[++i]);
+            search.maxPeriod = atoi(argv[++i]);
+        }else if(numParams < 5){
+            params[numParams++] = argv[i];
+        }
+    }
+    /* in server mode the only positional parameter is the optional default seed */
+    if(serve && numParams == 1){
+        params[4] = params[0];
+        numParams = 5;
+    }
+    /* in sweep and network mode the only positional parameter is the optional seed, so move it to where it is expected */
+    char *inputFile = sweepFile != NULL ? sweepFile : networkFile;
+    if(inputFile != NULL && numParams == 1){
+        params[4] = params[0];
+        numParams = 5;
+    }
+    /* when optimizing, the positional parameters are the two arrival rates and the optional seed */
+    if(search.objective >= 0 && numParams >= 2){
+        search.arrivalRateLHS = atoi(params[0]);
+        search.arrivalRateRHS = atoi(params[1]);
+        params[4] = numParams > 2 ? params[2] : NULL;
+        numParams = numParams > 2 ? 5 : 4;
+    }
+    /* otherwise all four of the simulation parameters are required, a light period of 0 would never change */
+    if((inputFile == NULL && serve == 0 && numParams < 4) || search.minPeriod < 1 || search.maxPeriod < search.minPeriod){
+        fprintf(stderr, "usage: %s arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [seed] [--percentiles] "
+                        "[--trace FILE] [--target METRIC HALFWIDTH] [options]\n"
+                        "       %s --sweep FILE [seed] [--store STORE [--processes N]] [options]\n"
+                        "       %s --network FILE [seed] [options]\n"
+                        "       %s --optimize wait|clearance arrivalRateLHS arrivalRateRHS [seed] [--periods MIN MAX] "
+                        "[options]\n"
+                        "       %s arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [seed] "
+                        "--compare arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [--antithetic] [options]\n"
+                        "       %s arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS [seed] "
+                        "--steady-state TICKS [--batch-size N]\n"
+                        "       %s --serve [seed] [--socket PATH] [--cache FILE] [options]\n"
+                        "options: --threads N, --engine tick|event, --simd, --replications N\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 0;
+    }
+    /* when stopping adaptively, the number of replications is only a limit */
+    if(options.metric >= 0 && replicationsSet == 0){
+        options.replications = MAX_ADAPTIVE_REPLICATIONS;
+    }
+    /* and when optimizing, it is the most replications any one candidate is given */
+    if(search.objective >= 0 && replicationsSet == 0){
+        options.replications = MAX_OPTIMIZER_REPLICATIONS;
+    }
+    if(options.replications < 1){
+        options.replications = 1;
+    }
+    /* a thread count of 0 (or less) means use every core, and the same goes for the worker processes */
+    if(options.threads <= 0){
+        options.threads = get_num_cores();
+    }
+    if(processes <= 0){
+        processes = get_num_cores();
+    }
+
+    /* find the mode being run, if it is not a plain run, so the options only a plain run uses can be turned away */
+    const char *mode = NULL;
+    if(sweepFile != NULL){
+        mode = "--sweep";
+    }else if(networkFile != NULL){
+        mode = "--network";
+    }else if(search.objective >= 0){
+        mode = "--optimize";
+    }else if(compare){
+        mode = "--compare";
+    }else if(steadyTicks > 0){
+        mode = "--steady-state";
+    }else if(serve){
+        mode = "--serve";
+    }
+    /* a trace record only says which replication a vehicle was in, so tracing is limited to the single configuration
+     * of a plain run, where the replication is enough to tell the simulations apart */
+    if(mode != NULL && traceFile != NULL){
+        fprintf(stderr, "--trace can't be used with %s, it only records a single configuration\n", mode);
+        return 0;
+    }
+    /* the other modes have no waiting time percentiles to show */
+    if(mode != NULL && percentiles){
+        fprintf(stderr, "--percentiles can't be used with %s, only a plain run shows the percentiles\n", mode);
+        return 0;
+    }
+    /* the other modes run a fixed number of replications, which --target would raise to MAX_ADAPTIVE_REPLICATIONS */
+    if(mode != NULL && options.metric >= 0){
+        fprintf(stderr, "--target can't be used with %s, only a plain run stops adaptively\n", mode);
+        return 0;
+    }
 
-    /* pass the passed in inputs as well as the result from the runs, into the display function */
-    display(atoi(argv[1]),
-            atoi(argv[2]),
-            atoi(argv[3]),
-            atoi(argv[4]),
-            dat);
+    /* when tracing, every vehicle goes through remove_first_node, which the SIMD kernel does not use */
+    if(traceFile != NULL){
+        if(trace_open(traceFile) == 1){
+            fprintf(stderr, "could not create trace file %s\n", traceFile);
+            return 0;
+        }
+        options.backend = BACKEND_SCALAR;
+    }
+
+    /* use the seed passed in if there is one, otherwise seed based on the current time */
+    if(numParams > 4){
+        options.seed = strtoul(params[4], NULL, 10);
+    }else if(sweepFile != NULL && shardStore != NULL && read_store_seed(shardStore, &options.seed) == 0){
+        /* a resumed sharded sweep carries on with the seed it was started with */
+    }else{
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        options.seed = tv.tv_sec * 1000000UL + tv.tv_usec;
+    }
+
+    /* in server mode, answer requests until asked to shut down */
+    if(serve){
+        int ok = runServer(socketPath, storePath, &options);
+        COUNT_PRINT(stderr);
+        /* return 1 to show a successful run of the code */
+        return ok == 0;
+    }
+
+    /* in sweep mode, run every configuration of the file and stream the results out as CSV */
+    /* in network mode, simulate the topology of the file and write out the results of each approach as CSV */
+    if(inputFile != NULL){
+        FILE *in = stdin;
+        if(strcmp(inputFile, "-") != 0){
+            in = fopen(inputFile, "r");
+            if(in == NULL){
+                fprintf(stderr, "could not open %s\n", inputFile);
+                return 0;
+            }
+        }
+        int ok;
+        if(sweepFile != NULL && shardStore != NULL){
+            ok = runShardedSweep(in, stdout, shardStore, processes, &options);
+        }else if(sweepFile != NULL){
+            ok = runSweep(in, stdout, &options);
+        }else{
+            ok = runNetwork(in, stdout, &options);
+        }
+        if(in != stdin){
+            fclose(in);
+        }
+        /* the CSV rows go to stdout, so any instrumentation counts go to stderr */
+        COUNT_PRINT(stderr);
+        /* return 1 to show a successful run of the code */
+        return ok == 0;
+    }
+
+    /* in optimizer mode, search the light periods and report the best ones as CSV */
+    if(search.objective >= 0){
+        /* return 1 to show a successful run of the code */
+        int ok = runOptimizer(&search, &options, stdout);
+        COUNT_PRINT(stderr);
+        return ok == 0;
+    }
+
+    /* in compare mode, report the paired differences between the two configurations as CSV */
+    if(compare){
+        SimConfig config = {atoi(params[0]), atoi(params[1]), atoi(params[2]), atoi(params[3])};
+        /* return 1 to show a successful run of the code */
+        int ok = runCompare(&config, &compareWith, variates, &options, stdout);
+        COUNT_PRINT(stderr);
+        return ok == 0;
+    }
+
+    /* in steady state mode, stream the batch means estimates of one long simulation as CSV */
+    if(steadyTicks > 0){
+        SimConfig config = {atoi(params[0]), atoi(params[1]), atoi(params[2]), atoi(params[3])};
+        int ok = runSteadyState(&config, steadyTicks, batchSize, &options, stdout);
+        COUNT_PRINT(stderr);
+        /* return 1 to show a successful run of the code */
+        return ok == 0;
+    }
+
+    /* call the runSimulations function with the passed in inputs in integer format, only recording the waiting time
+     * histograms when the percentiles are wanted, as recording costs the SIMD backend a pass over every queue */
+    ResultStats stats;
+    WaitHistograms waits;
+    WaitHistograms *recorded = percentiles ? &waits : NULL;
+    ReturnData mean = runSimulations(atoi(params[0]),
+                                     atoi(params[1]),
+                                     atoi(params[2]),
+                                     atoi(params[3]),
+                                     &options,
+                                     &stats,
+                                     recorded);
+
+    /* pass the passed in inputs as well as the statistics from the runs, into the display function */
+    display(atoi(params[0]),
+            atoi(params[1]),
+            atoi(params[2]),
+            atoi(params[3]),
+            options.seed,
+            &stats,
+            recorded);
+
+    /* when the instrumentation is compiled in, print its counts after the results */
+    COUNT_PRINT(stdout);
+
+    /* finish writing the trace */
+    if(trace_close() == 1){
+        fprintf(stderr, "could not write trace file %s\n", traceFile);
+        return 0;
+    }
+
+    /* a thread with no memory for its histograms leaves its vehicles out of the percentiles */
+    if(recorded != NULL && mean.status == 0){
+        fprintf(stderr, "could not record the waiting time of every vehicle, the percentiles are incomplete\n");
+        return 0;
+    }
 
     /* return 1 to show a successful run of the code */
     return 1;
 }
+
+#endif
@@ -1,8 +1,59 @@
 #ifndef ECM2433___CW_RUNSIMULATIONS_H
 #define ECM2433___CW_RUNSIMULATIONS_H
-#endif
-/* Include the runOneSimulation header file as the functions in this c file will be used */
+
+/* Include the runOneSimulation header file as the functions in this c file will be used, it also brings in the
+ * SimConfig struct from simTypes.h */
 #include "runOneSimulation.h"
 
+/* Include the worker pool used to run the replications in parallel */
+#include "workerPool.h"
+
+/* Include the vectorised kernel used by the SIMD backend */
+#include "simdKernel.h"
+
+/* Include the streaming statistics used to combine the replications */
+#include "simStats.h"
+
+/* Include the instrumentation counters, which are compiled out unless SIM_COUNTERS is defined */
+#include "simCounters.h"
+
+/* Include the waiting time histograms used for the percentiles */
+#include "simHistogram.h"
+
+/* The number of times runOneSimulation is called by runSimulations by default */
+#define NUM_REPLICATIONS 100
+
+/* When stopping adaptively, the number of replications run between checks of the confidence interval, and the most
+ * replications that will be run if no limit is given */
+#define ADAPTIVE_ROUND 32
+#define MAX_ADAPTIVE_REPLICATIONS 100000
+
+/* The struct Opts, aka SimOptions, holds the settings of a runSimulations call
+ * unsigned long seed - the master seed, replication i always uses stream i of this seed
+ * int threads - the number of worker threads to spread the replications over
+ * int engine - the engine runOneSimulation uses, ENGINE_TICK or ENGINE_EVENT
+ * int backend - BACKEND_SIMD runs the tick engine's replications side by side in vector lanes, BACKEND_SCALAR one
+ *               at a time
+ * long replications - the number of replications to run (the most to run when stopping adaptively)
+ * int metric - the METRIC_ index to stop adaptively on, or -1 to always run every replication
+ * double target - the 95% confidence interval half width of metric to stop at */
+typedef struct Opts {
+    unsigned long seed;
+    int threads;
+    int engine;
+    int backend;
+    long replications;
+    int metric;
+    double target;
+}SimOptions;
+
+/* The backends that runSimulations can use for the replications of the tick engine */
+#define BACKEND_SCALAR 0
+#define BACKEND_SIMD 1
+
 /* Declare the runSimulations functions of runSimulations.c and speficy its return type */
-ReturnData runSimulations();
+ReturnData runSimulations(int arrivalRateLHS, int lightPeriodLHS, int arrivalRateRHS, int lightPeriodRHS,
+                          SimOptions *options, ResultStats *stats, WaitHistograms *waits);
+ReturnData combine_results(ReturnData *results, int count);
+
+#endif
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "runSteadyState.h"
+
+/*
+ * runSteadyState runs a single long simulation where vehicles never stop arriving, and estimates the long run mean
+ * waiting time and queue length of each light by the method of batch means.
+ *
+ * The run starts with empty queues, so the first iterations are not typical of the steady state. The first
+ * STEADY_WARMUP_BATCHES short batches are kept, and the warm-up is taken to end at the truncation point chosen by the
+ * MSER rule on their mean total queue length (the point that minimises the standard error of what is left). Only the
+ * iterations after it count towards the estimates. The short batches are a tenth of a batch, or shorter when the run
+ * is too short for that, so that the search never takes more than the first half of the run and at least
+ * STEADY_MIN_BATCHES full batches follow it.
+ *
+ * After the warm-up the run is split into batches of batchSize iterations. The means of the batches are close to
+ * independent when the batches are long enough, so the confidence interval of the mean comes from the spread of the
+ * batch means. The lag 1 autocorrelation of the batch means is reported so that batches that are too short show up.
+ *
+ * Memory use does not depend on the number of iterations, and the iteration numbers held by the queued vehicles are
+ * moved back every so often so that the run can go on for billions of iterations.
+*/
+
+/* The iteration count at which the queued vehicles' iteration numbers are moved back towards 0 */
+#define REBASE_ITERATION (1 << 30)
+
+/* The metrics estimated, the waiting time of the vehicles leaving each light and the length of each queue */
+#define STEADY_WAIT_LHS 0
+#define STEADY_WAIT_RHS 1
+#define STEADY_QUEUE_LHS 2
+#define STEADY_QUEUE_RHS 3
+#define STEADY_METRICS 4
+
+/*
+ * BatchSums holds the running totals of the batch being built
+ * double waits[2] - the sum of the waiting times of the vehicles leaving each light
+ * long departures[2] - the number of vehicles leaving each light
+ * double queues[2] - the sum over the iterations of the length of each queue
+ * long iterations - the number of iterations in the batch
+*/
+struct BatchSums {
+    double waits[2];
+    long departures[2];
+    double queues[2];
+    long iterations;
+};
+
+/*
+ * BatchMeans holds the statistics of the completed batches
+ * RunningStat metrics[] - the batch means of each STEADY_ metric
+ * double lagSum - the sum of the products of consecutive batch means of the total waiting time, for the autocorrelation
+ * double last - the previous batch mean of the total waiting time, or -1 before the first batch
+*/
+struct BatchMeans {
+    RunningStat metrics[STEADY_METRICS];
+    RunningStat totalWait;
+    double lagSum;
+    double last;
+};
+
+/**
+ * clear_sums empties the running totals of a batch
+ * @param sums - the totals to clear
+ */
+static void clear_sums(struct BatchSums *sums){
+    struct BatchSums empty = {{0, 0}, {0, 0}, {0, 0}, 0};
+    *sums = empty;
+}
+
+/**
+ * add_sums adds the totals of one batch to those of another
+ * @param sums - the totals to add to
+ * @param other - the totals to add
+ */
+static void add_sums(struct BatchSums *sums, const struct BatchSums *other){
+    int side;
+    for(side = 0; side < 2; side++){
+        sums->waits[side] += other->waits[side];
+        sums->departures[side] += other->departures[side];
+        sums->queues[side] += other->queues[side];
+    }
+    sums->iterations += other->iterations;
+}
+
+/**
+ * add_batch adds the means of a completed batch to the statistics, a light with no departures in the batch gives no
+ * waiting time for it
+ * @param means - the statistics of the batches
+ * @param sums - the totals of the completed batch
+ */
+static void add_batch(struct BatchMeans *means, struct BatchSums *sums){
+    int side;
+    for(side = 0; side < 2; side++){
+        if(sums->departures[side] > 0){
+            stat_add(&means->metrics[STEADY_WAIT_LHS + side], sums->waits[side] / sums->departures[side]);
+        }
+        stat_add(&means->metrics[STEADY_QUEUE_LHS + side], sums->queues[side] / sums->iterations);
+    }
+    long departures = sums->departures[0] + sums->departures[1];
+    if(departures > 0){
+        double wait = (sums->waits[0] + sums->waits[1]) / departures;
+        if(means->last >= 0){
+            means->lagSum += (means->last - means->totalWait.mean) * (wait - means->totalWait.mean);
+        }
+        stat_add(&means->totalWait, wait);
+        means->last = wait;
+    }
+}
+
+/**
+ * lag_correlation estimates the lag 1 autocorrelation of the batch means of the total waiting time
+ * The products are taken about the running mean, which is close enough once there are a few batches
+ * @param means - the statistics of the batches
+ * @return - the autocorrelation, 0 if there are too few batches
+ */
+static double lag_correlation(struct BatchMeans *means){
+    if(means->totalWait.count < 3 || means->totalWait.m2 <= 0){
+        return 0;
+    }
+    return means->lagSum / means->totalWait.m2;
+}
+
+/**
+ * write_row writes a CSV row of the estimates so far
+ * @param out - the stream to write to
+ * @param ticks - the number of iterations simulated so far
+ * @param warmup - the number of iterations discarded as warm-up
+ * @param means - the statistics of the batches
+ */
+static void write_row(FILE *out, long ticks, long warmup, struct BatchMeans *means){
+    int metric;
+    fprintf(out, "%ld,%ld,%ld", ticks, warmup, means->metrics[STEADY_QUEUE_LHS].count);
+    for(metric = 0; metric < STEADY_METRICS; metric++){
+        fprintf(out, ",%f,%f", means->metrics[metric].mean, stat_half_width(&means->metrics[metric]));
+    }
+    fprintf(out, ",%f\n", lag_correlation(means));
+    fflush(out);
+}
+
+/**
+ * mser_truncation finds the MSER truncation point of a series of batch means, the number of leading batches to
+ * discard so that the standard error of the mean of the rest is smallest, looking at no more than half the series
+ * @param values - the batch means
+ * @param count - the number of batch means
+ * @return - the number of batches to discard
+ */
+static int mser_truncation(const double *values, int count){
+    double sum = 0, sumSquares = 0, best = HUGE_VAL;
+    int d, truncation = 0;
+    /* work backwards, so the sums of the rest of the series can be kept as batches are added to it */
+    for(d = count - 1; d >= 0; d--){
+        sum += values[d];
+        sumSquares += values[d] * values[d];
+        if(d <= count / 2){
+            double n = count - d;
+            double mser = (sumSquares - sum * sum / n) / (n * n);
+            if(mser <= best){
+                best = mser;
+                truncation = d;
+            }
+        }
+    }
+    return truncation;
+}
+
+/**
+ * runSteadyState runs one long simulation of a configuration, see the top of this file, writing a CSV row of the
+ * estimates every STEADY_REPORT_BATCHES batches and once more at the end
+ * @param config - the configuration to simulate, both light periods must be at least 1
+ * @param ticks - the number of iterations to simulate, at least 2 * STEADY_MIN_BATCHES batches
+ * @param batchSize - the number of iterations in each batch
+ * @param options - the seed of the simulation
+ * @param out - the stream to write the CSV rows to
+ * @return - an integer to state whether the simulation was successful(0) or not(1)
+ */
+int runSteadyState(SimConfig *config, long ticks, long batchSize, SimOptions *options, FILE *out){
+    struct Lights leftLight, rightLight;
+    struct Lights *lights[2];
+    struct BatchSums sums;
+    struct BatchMeans means;
+    SimRandom rng;
+    Arrivals arrivals;
+    double *warmupMeans;
+    struct BatchSums *warmupBatches;
+    long warmupSize;
+    int numWarmup = 0;
+    long warmup = -1;
+    long base = 0;
+    long reported = -1;
+    int iteration = 0;
+    int metric, side;
+    long tick;
+
+    if(config->lightPeriodLHS < 1 || config->lightPeriodRHS < 1 || batchSize < 1){
+        return 1;
+    }
+    /* the warm-up search takes at most half the run, and the other half has to hold enough batches to estimate from */
+    if(ticks / (2 * STEADY_MIN_BATCHES) < batchSize){
+        fprintf(stderr, "%ld ticks is too short for batches of %ld, the run needs at least %d batches (half of them for "
+                        "the warm-up search), so use a smaller --batch-size or more ticks\n",
+                ticks, batchSize, 2 * STEADY_MIN_BATCHES);
+        return 1;
+    }
+    warmupSize = batchSize / 10;
+    if(warmupSize > ticks / (2 * STEADY_WARMUP_BATCHES)){
+        warmupSize = ticks / (2 * STEADY_WARMUP_BATCHES);
+    }
+    if(warmupSize < 1){
+        warmupSize = 1;
+    }
+    /* each cycle of the lights has lightPeriodLHS + lightPeriodRHS iterations where vehicles can arrive, and lets
+     * lightPeriod vehicles through each light, so a light that gets as many vehicles as that never settles down */
+    int cycle = config->lightPeriodLHS + config->lightPeriodRHS;
+    if(arrival_probability(config->arrivalRateLHS) * cycle >= config->lightPeriodLHS
+       || arrival_probability(config->arrivalRateRHS) * cycle >= config->lightPeriodRHS){
+        fprintf(stderr, "vehicles arrive faster than the lights let them through, so this configuration has no steady "
+                        "state\n");
+        return 1;
+    }
+    init_lights(&leftLight, config->lightPeriodLHS, 0);
+    init_lights(&rightLight, config->lightPeriodRHS, 1);
+    /* malloc the space for the short batches of the warm-up search and the queue of each light */
+    warmupMeans = (double*) malloc(sizeof(double) * STEADY_WARMUP_BATCHES);
+    warmupBatches = (struct BatchSums*) malloc(sizeof(struct BatchSums) * STEADY_WARMUP_BATCHES);
+    if(warmupMeans == NULL || warmupBatches == NULL || init_queue(&leftLight) == 1){
+        free(warmupMeans);
+        free(warmupBatches);
+        return 1;
+    }
+    if(init_queue(&rightLight) == 1){
+        free(warmupMeans);
+        free(warmupBatches);
+        free(leftLight.queue);
+        return 1;
+    }
+    lights[0] = &leftLight;
+    lights[1] = &rightLight;
+    sim_random_init(&rng, options->seed, 0);
+    arrivals_init(&arrivals, config->arrivalRateLHS, config->arrivalRateRHS, VARIATES_PLAIN);
+    clear_sums(&sums);
+    for(metric = 0; metric < STEADY_METRICS; metric++){
+        stat_init(&means.metrics[metric]);
+    }
+    stat_init(&means.totalWait);
+    means.lagSum = 0;
+    means.last = -1;
+
+    fprintf(out, "ticks,warmupTicks,batches,avgTimeLHS,avgTimeLHSHalfWidth,avgTimeRHS,avgTimeRHSHalfWidth,"
+                 "queueLengthLHS,queueLengthLHSHalfWidth,queueLengthRHS,queueLengthRHSHalfWidth,lag1Correlation\n");
+
+    int failed = 0;
+    for(tick = 0; tick < ticks; tick++){
+        /* move the iteration numbers back so they never overflow, the waiting times are unchanged, and clear the
+         * per light statistics of add_node and remove_first_node, which are not used here, for the same reason */
+        if(iteration == REBASE_ITERATION){
+            for(side = 0; side < 2; side++){
+                int i;
+                for(i = 0; i < lights[side]->length; i++){
+                    lights[side]->queue[(lights[side]->head + i) & (lights[side]->capacity - 1)].iterationGenerated
+                        -= REBASE_ITERATION;
+                }
+                lights[side]->numOfVehicles = 0;
+                lights[side]->numPassed = 0;
+                lights[side]->avgTime = 0;
+                lights[side]->maxTime = 0;
+            }
+            base += REBASE_ITERATION;
+            iteration = 0;
+        }
+
+        /* run the iteration exactly as the tick engine does while vehicles are arriving */
+        struct Lights *green = rightLight.status == 1 ? &rightLight : &leftLight;
+        struct Lights *red = green == &rightLight ? &leftLight : &rightLight;
+        if(update_light(green, red) == 0){
+            /* the arrival masks are indexed by tick, which unlike iteration is never moved back */
+            arrivals_advance(&arrivals, &rng, tick);
+            int bit = (int)(tick - arrivals.start);
+            if(((arrivals.maskLHS >> bit) & 1) && add_node(&leftLight, iteration) == 1){
+                failed = 1;
+                break;
+            }
+            if(((arrivals.maskRHS >> bit) & 1) && add_node(&rightLight, iteration) == 1){
+                failed = 1;
+                break;
+            }
+            if(is_empty(green) == 0){
+                int g = green == &rightLight;
+                sums.waits[g] += iteration - green->queue[green->head].iterationGenerated;
+                sums.departures[g]++;
+                remove_first_node(green, iteration);
+            }
+        }
+        sums.queues[0] += leftLight.length;
+        sums.queues[1] += rightLight.length;
+        sums.iterations++;
+        iteration++;
+
+        if(leftLight.length > STEADY_MAX_QUEUE || rightLight.length > STEADY_MAX_QUEUE){
+            fprintf(stderr, "the queues grow without bound, so this configuration has no steady state\n");
+            failed = 1;
+            break;
+        }
+
+        if(warmup < 0){
+            /* during the warm-up search, keep the totals of each short batch */
+            if(sums.iterations == warmupSize){
+                warmupBatches[numWarmup] = sums;
+                warmupMeans[numWarmup] = (sums.queues[0] + sums.queues[1]) / sums.iterations;
+                numWarmup++;
+                clear_sums(&sums);
+                if(numWarmup == STEADY_WARMUP_BATCHES){
+                    /* everything before the truncation point is warm-up, the short batches after it are combined
+                     * into the first full batches */
+                    int first = mser_truncation(warmupMeans, numWarmup);
+                    int i;
+                    warmup = first * warmupSize;
+                    for(i = first; i < numWarmup; i++){
+                        add_sums(&sums, &warmupBatches[i]);
+                        if(sums.iterations >= batchSize){
+                            add_batch(&means, &sums);
+                            clear_sums(&sums);
+                        }
+                    }
+                }
+            }
+        }else if(sums.iterations == batchSize){
+            add_batch(&means, &sums);
+            clear_sums(&sums);
+            if(means.metrics[STEADY_QUEUE_LHS].count % STEADY_REPORT_BATCHES == 0){
+                write_row(out, base + iteration, warmup, &means);
+                reported = base + iteration;
+            }
+        }
+    }
+
+    /* write the final estimates, unless they were the last row written */
+    if(failed == 0 && reported != base + iteration){
+        write_row(out, base + iteration, warmup < 0 ? base + iteration : warmup, &means);
+    }
+    free(warmupMeans);
+    free(warmupBatches);
+    free(leftLight.queue);
+    free(rightLight.queue);
+    return failed;
+}
@@ -0,0 +1,27 @@
+#ifndef ECM2433___CW_RUNSTEADYSTATE_H
+#define ECM2433___CW_RUNSTEADYSTATE_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimConfig and SimOptions structs */
+#include "runSimulations.h"
+
+/* The number of iterations in each batch when no --batch-size is passed in */
+#define STEADY_BATCH_SIZE 10000
+
+/* The number of batches between the rows written out while the simulation runs */
+#define STEADY_REPORT_BATCHES 100
+
+/* The warm-up is looked for in the first STEADY_WARMUP_BATCHES short batches, each a tenth of the batch size, or
+ * shorter so that the search covers no more than half of the run */
+#define STEADY_WARMUP_BATCHES 1000
+
+/* The fewest batches left after the warm-up search, a run must be at least twice this many batches long */
+#define STEADY_MIN_BATCHES 10
+
+/* Once this many vehicles are waiting at one light its queue is growing without bound, so there is no steady state */
+#define STEADY_MAX_QUEUE (1 << 22)
+
+/* Declare the functions of runSteadyState.c */
+int runSteadyState(SimConfig *config, long ticks, long batchSize, SimOptions *options, FILE *out);
+
+#endif
@@ -0,0 +1,310 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "runSweep.h"
+
+/*
+ * Range is one field of a sweep line, either a single value or start:end:step
+*/
+struct Range {
+    long start;
+    long end;
+    long step;
+};
+
+/*
+ * SweepJob is the state shared by the workers while a chunk of configurations is run
+ * Task i of the pool runs batch (i % batches) of configuration (i / batches), see run_sweep_batch
+ * SimConfig *configs - the configurations of this chunk
+ * long first - the index of configs[0] in the whole sweep, printed in the CSV rows
+ * int lanes - the replications in each batch, from sweep_lanes
+ * long batches - the batches of each configuration
+ * ReturnData *results - options->replications result slots for every configuration
+ * long *remaining - the number of batches of each configuration that have not finished yet
+*/
+struct SweepJob {
+    SimConfig *configs;
+    long first;
+    SimOptions *options;
+    int lanes;
+    long batches;
+    ReturnData *results;
+    long *remaining;
+    pthread_mutex_t lock;
+    FILE *out;
+};
+
+/**
+ * parse_range reads one field of a sweep line
+ * @param text - the text of the field, e.g. "40" or "10:90:10"
+ * @param range - set to the values described by the field
+ * @return - an integer to state whether the field was valid(0) or not(1)
+ */
+static int parse_range(const char *text, struct Range *range){
+    char *end;
+    range->start = strtol(text, &end, 10);
+    range->end = range->start;
+    range->step = 1;
+    if(end == text){
+        return 1;
+    }
+    /* a single value */
+    if(*end == '\0'){
+        return 0;
+    }
+    /* start:end with an optional :step */
+    if(*end != ':'){
+        return 1;
+    }
+    text = end + 1;
+    range->end = strtol(text, &end, 10);
+    if(end == text){
+        return 1;
+    }
+    if(*end == ':'){
+        text = end + 1;
+        range->step = strtol(text, &end, 10);
+        if(end == text || range->step <= 0){
+            return 1;
+        }
+    }
+    if(*end != '\0' || range->end < range->start){
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * parse_line splits a line of a sweep file into its four fields and reads their ranges
+ * @param line - the line, which is changed by strtok
+ * @param lineNo - the number of the line, for the message about a line that is not valid
+ * @param ranges - set to the ranges of the four fields
+ * @return - an integer to state whether the line holds configurations(0) or is to be skipped(1)
+ */
+static int parse_line(char *line, int lineNo, struct Range ranges[4]){
+    char *fields[4];
+    int numFields = 0;
+    char *token;
+
+    /* split the line into its fields, skipping blank and comment lines */
+    for(token = strtok(line, " ,\t\r\n"); token != NULL && numFields < 4; token = strtok(NULL, " ,\t\r\n")){
+        fields[numFields++] = token;
+    }
+    if(numFields == 0 || fields[0][0] == '#'){
+        return 1;
+    }
+    if(numFields < 4 || parse_range(fields[0], &ranges[0]) || parse_range(fields[1], &ranges[1])
+                     || parse_range(fields[2], &ranges[2]) || parse_range(fields[3], &ranges[3])){
+        fprintf(stderr, "sweep line %d is not valid, skipping it\n", lineNo);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * read_sweep reads every configuration of a sweep file into one array, expanding the ranges of each line, see runSweep
+ * for the format
+ * @param in - the stream to read the configurations from
+ * @param configs - set to the malloced array of configurations, which the caller frees
+ * @param count - set to the number of configurations
+ * @return - an integer to state whether the file was read(0) or memory ran out(1)
+ */
+int read_sweep(FILE *in, SimConfig **configs, long *count){
+    char line[256];
+    int lineNo = 0;
+    long capacity = 0;
+    *configs = NULL;
+    *count = 0;
+    while(fgets(line, sizeof(line), in) != NULL){
+        struct Range ranges[4];
+        long a, b, c, d;
+        lineNo++;
+        if(parse_line(line, lineNo, ranges)){
+            continue;
+        }
+        for(a = ranges[0].start; a <= ranges[0].end; a += ranges[0].step){
+            for(b = ranges[1].start; b <= ranges[1].end; b += ranges[1].step){
+                for(c = ranges[2].start; c <= ranges[2].end; c += ranges[2].step){
+                    for(d = ranges[3].start; d <= ranges[3].end; d += ranges[3].step){
+                        SimConfig config = {(int)a, (int)b, (int)c, (int)d};
+                        /* double the array whenever it is full */
+                        if(*count == capacity){
+                            long grown = capacity > 0 ? capacity * 2 : SWEEP_CHUNK;
+                            SimConfig *bigger = (SimConfig*) realloc(*configs, sizeof(SimConfig) * grown);
+                            if(bigger == NULL){
+                                free(*configs);
+                                *configs = NULL;
+                                *count = 0;
+                                return 1;
+                            }
+                            *configs = bigger;
+                            capacity = grown;
+                        }
+                        (*configs)[(*count)++] = config;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * write_sweep_header writes the header row of the CSV written by the sweep modes
+ * @param out - the stream to write to
+ */
+void write_sweep_header(FILE *out){
+    fprintf(out, "config,arrivalRateLHS,lightPeriodLHS,arrivalRateRHS,lightPeriodRHS,"
+                 "numOfVehiclesLHS,avgTimeLHS,maxTimeLHS,clearanceTimeLHS,"
+                 "numOfVehiclesRHS,avgTimeRHS,maxTimeRHS,clearanceTimeRHS,status\n");
+}
+
+/**
+ * write_sweep_row writes the CSV row of a configuration once all of its replications have finished
+ * @param out - the stream to write to
+ * @param index - the index of the configuration in the sweep
+ * @param config - the configuration that was simulated
+ * @param res - the averaged result of the configuration
+ */
+void write_sweep_row(FILE *out, long index, SimConfig *config, ReturnData res){
+    fprintf(out, "%ld,%d,%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%d\n",
+            index,
+            config->arrivalRateLHS,
+            config->lightPeriodLHS,
+            config->arrivalRateRHS,
+            config->lightPeriodRHS,
+            res.numOfVehiclesLHS,
+            res.avgTimeLHS,
+            res.maxTimeLHS,
+            res.clearanceTimeLHS,
+            res.numOfVehiclesRHS,
+            res.avgTimeRHS,
+            res.maxTimeRHS,
+            res.clearanceTimeRHS,
+            (int)res.status);
+}
+
+/**
+ * sweep_lanes gets the number of replications of a configuration that one task of the sweep modes runs
+ * @param options - the engine and backend of the sweep
+ * @return - simd_lanes() when the SIMD backend runs the tick engine, otherwise 1
+ */
+int sweep_lanes(SimOptions *options){
+    if(options->backend == BACKEND_SIMD && options->engine == ENGINE_TICK){
+        return simd_lanes();
+    }
+    return 1;
+}
+
+/**
+ * run_sweep_batch runs one batch of the replications of a configuration, batch i being replications i * lanes onwards,
+ * side by side in vector lanes when there is more than one lane, which gives the same results
+ * @param config - the configuration
+ * @param options - the seed, engine and replications of the sweep
+ * @param lanes - the replications in each batch, from sweep_lanes
+ * @param batch - the batch to run
+ * @param results - the options->replications result slots of the configuration
+ */
+void run_sweep_batch(SimConfig *config, SimOptions *options, int lanes, long batch, ReturnData *results){
+    long first = batch * lanes;
+    int count = options->replications - first < lanes ? (int)(options->replications - first) : lanes;
+    if(lanes > 1){
+        runSimdBatch(config->arrivalRateLHS, config->lightPeriodLHS, config->arrivalRateRHS, config->lightPeriodRHS,
+                     options->seed, first, count, results + first);
+        return;
+    }
+    results[first] = runOneSimulation(config->arrivalRateLHS, config->lightPeriodLHS,
+                                      config->arrivalRateRHS, config->lightPeriodRHS,
+                                      options->seed, first, options->engine, VARIATES_PLAIN);
+}
+
+/**
+ * run_sweep_task is the worker pool task that runs one batch of replications of one configuration
+ * The worker that finishes the last batch of a configuration combines them and writes its row straight away
+ * @param index - the task index, see SweepJob
+ * @param arg - pointer to the SweepJob being run
+ */
+static void run_sweep_task(long index, void *arg){
+    struct SweepJob *job = (struct SweepJob*) arg;
+    long replications = job->options->replications;
+    long config = index / job->batches;
+    SimConfig *c = &job->configs[config];
+    ReturnData *results = job->results + config * replications;
+
+    run_sweep_batch(c, job->options, job->lanes, index % job->batches, results);
+
+    /* count this batch off, and write the row if it was the last one of its configuration */
+    pthread_mutex_lock(&job->lock);
+    job->remaining[config]--;
+    if(job->remaining[config] == 0){
+        write_sweep_row(job->out, job->first + config, c, combine_results(results, (int)replications));
+        fflush(job->out);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * run_chunk runs every batch of a chunk of configurations as one flat pool of tasks
+ * @param job - the job holding the configurations, with results and remaining large enough for them
+ * @param count - the number of configurations in the chunk
+ */
+static void run_chunk(struct SweepJob *job, long count){
+    long i;
+    for(i = 0; i < count; i++){
+        job->remaining[i] = job->batches;
+    }
+    run_pool(count * job->batches, job->options->threads, run_sweep_task, job);
+}
+
+/**
+ * runSweep reads configurations from in, simulates each of them options->replications times and writes a CSV row per
+ * configuration to out as soon as it finishes
+ * Each line of in holds the four parameters arrivalRateLHS lightPeriodLHS arrivalRateRHS lightPeriodRHS, separated by
+ * spaces or commas. Any parameter may be a range start:end[:step], and a line with ranges expands to every combination
+ * of them. Blank lines and lines starting with '#' are skipped
+ * @param in - the stream to read the configurations from
+ * @param out - the stream to write the CSV rows to
+ * @param options - the seed, engine, backend, number of threads and replications to use
+ * @return - an integer to state whether the sweep was successful(0) or not(1)
+ */
+int runSweep(FILE *in, FILE *out, SimOptions *options){
+    struct SweepJob job;
+    SimConfig *configs;
+    long count;
+    if(read_sweep(in, &configs, &count) == 1){
+        return 1;
+    }
+
+    /* malloc the space for the results of one chunk of configurations */
+    job.results = (ReturnData*) malloc(sizeof(ReturnData) * SWEEP_CHUNK * options->replications);
+    job.remaining = (long*) malloc(sizeof(long) * SWEEP_CHUNK);
+    /* check that these mallocs were successful */
+    if(job.results == NULL || job.remaining == NULL){
+        free(configs);
+        free(job.results);
+        free(job.remaining);
+        return 1;
+    }
+    job.options = options;
+    job.lanes = sweep_lanes(options);
+    job.batches = (options->replications + job.lanes - 1) / job.lanes;
+    job.out = out;
+    pthread_mutex_init(&job.lock, NULL);
+
+    write_sweep_header(out);
+
+    /* run the configurations a chunk at a time */
+    for(job.first = 0; job.first < count; job.first += SWEEP_CHUNK){
+        job.configs = configs + job.first;
+        run_chunk(&job, count - job.first < SWEEP_CHUNK ? count - job.first : SWEEP_CHUNK);
+    }
+
+    /* free the memory used by the sweep */
+    pthread_mutex_destroy(&job.lock);
+    free(configs);
+    free(job.results);
+    free(job.remaining);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef ECM2433___CW_RUNSWEEP_H
+#define ECM2433___CW_RUNSWEEP_H
+
+#include <stdio.h>
+/* Include the runSimulations header file for the SimConfig and SimOptions structs */
+#include "runSimulations.h"
+
+/* The number of configurations whose replications are put into the worker pool at once */
+#define SWEEP_CHUNK 1024
+
+/* Declare the functions of runSweep.c */
+int runSweep(FILE *in, FILE *out, SimOptions *options);
+int read_sweep(FILE *in, SimConfig **configs, long *count);
+int sweep_lanes(SimOptions *options);
+void run_sweep_batch(SimConfig *config, SimOptions *options, int lanes, long batch, ReturnData *results);
+void write_sweep_header(FILE *out);
+void write_sweep_row(FILE *out, long index, SimConfig *config, ReturnData res);
+
+#endif
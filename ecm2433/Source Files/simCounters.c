@@ -0,0 +1,128 @@
+#include <pthread.h>
+#include "simCounters.h"
+
+/* simCounters.c is empty unless the counters are compiled in */
+#ifdef SIM_COUNTERS
+
+/* the counts of this thread since it last flushed */
+__thread SimCounters sim_counters;
+
+/* the counts flushed by every thread */
+static SimCounters total;
+static pthread_mutex_t totalLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * read_cycles reads the CPU's cycle counter
+ * @return - the number of cycles since an arbitrary point, or 0 where there is no cycle counter
+ */
+static unsigned long long read_cycles(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * counters_ticks counts a run of simulated iterations, splitting them between the arrival and clearance phases
+ * @param iteration - the first iteration of the run
+ * @param count - the number of iterations in the run
+ * @param max - the number of iterations where vehicles are allowed to arrive
+ */
+void counters_ticks(int iteration, int count, int max){
+    int arrivals = max + 1 - iteration;
+    if(arrivals < 0){
+        arrivals = 0;
+    }
+    if(arrivals > count){
+        arrivals = count;
+    }
+    sim_counters.arrivalTicks += arrivals;
+    sim_counters.clearanceTicks += count - arrivals;
+}
+
+/**
+ * counters_start starts timing the arrival phase of a simulation
+ */
+void counters_start(){
+    sim_counters.simulations++;
+    sim_counters.phase = 1;
+    sim_counters.phaseStart = read_cycles();
+}
+
+/**
+ * counters_phase moves the timing on to the clearance phase once the iteration has passed max
+ * @param iteration - the iteration about to be simulated
+ * @param max - the number of iterations where vehicles are allowed to arrive
+ */
+void counters_phase(int iteration, int max){
+    if(sim_counters.phase == 1 && iteration > max){
+        unsigned long long now = read_cycles();
+        sim_counters.arrivalCycles += now - sim_counters.phaseStart;
+        sim_counters.phase = 2;
+        sim_counters.phaseStart = now;
+    }
+}
+
+/**
+ * counters_end stops timing the simulation, adding the cycles since the last phase started to that phase
+ */
+void counters_end(){
+    unsigned long long cycles = read_cycles() - sim_counters.phaseStart;
+    if(sim_counters.phase == 1){
+        sim_counters.arrivalCycles += cycles;
+    }else if(sim_counters.phase == 2){
+        sim_counters.clearanceCycles += cycles;
+    }
+    sim_counters.phase = 0;
+}
+
+/**
+ * counters_flush adds this thread's counts to the process total and clears them
+ */
+void counters_flush(){
+    SimCounters *c = &sim_counters;
+    pthread_mutex_lock(&totalLock);
+    total.arrivalTicks += c->arrivalTicks;
+    total.clearanceTicks += c->clearanceTicks;
+    total.arrivalCycles += c->arrivalCycles;
+    total.clearanceCycles += c->clearanceCycles;
+    total.rngDraws += c->rngDraws;
+    total.arrivalsLHS += c->arrivalsLHS;
+    total.arrivalsRHS += c->arrivalsRHS;
+    total.departuresLHS += c->departuresLHS;
+    total.departuresRHS += c->departuresRHS;
+    total.lightSwitches += c->lightSwitches;
+    total.allocations += c->allocations;
+    total.simulations += c->simulations;
+    /* the high water marks are the largest of any thread */
+    if(c->highWaterLHS > total.highWaterLHS){
+        total.highWaterLHS = c->highWaterLHS;
+    }
+    if(c->highWaterRHS > total.highWaterRHS){
+        total.highWaterRHS = c->highWaterRHS;
+    }
+    pthread_mutex_unlock(&totalLock);
+    SimCounters empty = {0};
+    *c = empty;
+}
+
+/**
+ * counters_print writes the process total as a single line of JSON, after flushing the calling thread
+ * @param out - the stream to write to
+ */
+void counters_print(FILE *out){
+    counters_flush();
+    pthread_mutex_lock(&totalLock);
+    fprintf(out, "{\"counters\": {\"simulations\": %llu, \"arrivalTicks\": %llu, \"clearanceTicks\": %llu, "
+                 "\"arrivalCycles\": %llu, \"clearanceCycles\": %llu, \"rngDraws\": %llu, "
+                 "\"arrivalsLHS\": %llu, \"arrivalsRHS\": %llu, \"departuresLHS\": %llu, \"departuresRHS\": %llu, "
+                 "\"lightSwitches\": %llu, \"highWaterLHS\": %llu, \"highWaterRHS\": %llu, \"allocations\": %llu}}\n",
+            total.simulations, total.arrivalTicks, total.clearanceTicks,
+            total.arrivalCycles, total.clearanceCycles, total.rngDraws,
+            total.arrivalsLHS, total.arrivalsRHS, total.departuresLHS, total.departuresRHS,
+            total.lightSwitches, total.highWaterLHS, total.highWaterRHS, total.allocations);
+    pthread_mutex_unlock(&totalLock);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ECM2433___CW_SIMCOUNTERS_H
+#define ECM2433___CW_SIMCOUNTERS_H
+
+#include <stdio.h>
+
+/*
+ * simCounters instruments the simulation loop. It is only compiled in when building with -DSIM_COUNTERS (e.g.
+ * CFLAGS=-DSIM_COUNTERS sh compileSim), otherwise every COUNT_ macro expands to nothing and the loop is unchanged.
+ *
+ * Each thread counts into its own sim_counters, so counting takes no locks. The worker pool adds a thread's counts
+ * to the process total with counters_flush when the thread runs out of tasks, and counters_print writes the total
+ * as JSON.
+*/
+
+/* The struct Counters, aka SimCounters, holds the counts of one thread or of the whole process
+ * arrivalTicks / clearanceTicks - the iterations simulated while vehicles could arrive / while the queues cleared
+ * arrivalCycles / clearanceCycles - the CPU cycles spent in each of those phases
+ * rngDraws - the 32 bit words drawn from the random streams
+ * arrivalsLHS / arrivalsRHS - the vehicles that arrived at each light
+ * departuresLHS / departuresRHS - the vehicles that left each light
+ * lightSwitches - the times update_light changed the lights
+ * highWaterLHS / highWaterRHS - the longest each light's queue has been
+ * allocations - the mallocs and reallocs of the queues
+ * simulations - the simulations run
+ * runSimdBatch counts each of its lanes as the tick engine would count that replication, except for the cycles, which
+ * are those of the whole batch, and the allocations, which are its two queue arrays per batch */
+typedef struct Counters {
+    unsigned long long arrivalTicks;
+    unsigned long long clearanceTicks;
+    unsigned long long arrivalCycles;
+    unsigned long long clearanceCycles;
+    unsigned long long rngDraws;
+    unsigned long long arrivalsLHS;
+    unsigned long long arrivalsRHS;
+    unsigned long long departuresLHS;
+    unsigned long long departuresRHS;
+    unsigned long long lightSwitches;
+    unsigned long long highWaterLHS;
+    unsigned long long highWaterRHS;
+    unsigned long long allocations;
+    unsigned long long simulations;
+    /* the phase being timed (0 none, 1 arrivals, 2 clearance) and the cycle count it started at */
+    int phase;
+    unsigned long long phaseStart;
+}SimCounters;
+
+#ifdef SIM_COUNTERS
+
+extern __thread SimCounters sim_counters;
+
+/* Declare the functions of simCounters.c */
+void counters_ticks(int iteration, int count, int max);
+void counters_phase(int iteration, int max);
+void counters_start();
+void counters_end();
+void counters_flush();
+void counters_print(FILE *out);
+
+#define COUNT(field) (sim_counters.field++)
+#define COUNT_ADD(field, count) (sim_counters.field += (count))
+#define COUNT_MAX(field, value) (sim_counters.field = (unsigned long long)(value) > sim_counters.field \
+                                                      ? (unsigned long long)(value) : sim_counters.field)
+#define COUNT_TICKS(iteration, count, max) counters_ticks(iteration, count, max)
+#define COUNT_PHASE(iteration, max) counters_phase(iteration, max)
+#define COUNT_START() counters_start()
+#define COUNT_END() counters_end()
+#define COUNT_FLUSH() counters_flush()
+#define COUNT_PRINT(out) counters_print(out)
+
+#else
+
+#define COUNT(field) ((void)0)
+#define COUNT_ADD(field, count) ((void)0)
+#define COUNT_MAX(field, value) ((void)0)
+#define COUNT_TICKS(iteration, count, max) ((void)0)
+#define COUNT_PHASE(iteration, max) ((void)0)
+#define COUNT_START() ((void)0)
+#define COUNT_END() ((void)0)
+#define COUNT_FLUSH() ((void)0)
+#define COUNT_PRINT(out) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "simHistogram.h"
+
+/* whether the simulations are recording their waiting times, whether a thread has had no memory for its histograms,
+ * the total of every thread that has finished, and the calling thread's own histograms */
+static int recording = 0;
+static int recordFailed = 0;
+static WaitHistograms totalHistograms;
+static pthread_mutex_t histogramLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread WaitHistograms *threadHistograms = NULL;
+
+/**
+ * histogram_highest gets the largest value that falls in a bucket, see the top of simHistogram.h
+ * @param bucket - the index of the bucket
+ * @return - the largest value of the bucket
+ */
+static int histogram_highest(int bucket){
+    if(bucket < HISTOGRAM_SUB_BUCKETS){
+        return bucket;
+    }
+    int shift = (bucket >> (HISTOGRAM_SUB_BITS - 1)) - 1;
+    long top = (long)((bucket & (HISTOGRAM_SUB_BUCKETS / 2 - 1)) + HISTOGRAM_SUB_BUCKETS / 2 + 1) << shift;
+    return (int)(top - 1);
+}
+
+/**
+ * histogram_init empties a histogram
+ * @param histogram - the histogram to empty
+ */
+void histogram_init(WaitHistogram *histogram){
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+/**
+ * histogram_add adds a value to a histogram
+ * @param histogram - the histogram
+ * @param value - the value to add, negative values are counted as 0
+ */
+void histogram_add(WaitHistogram *histogram, int value){
+    unsigned int v = value > 0 ? (unsigned int)value : 0;
+    HISTOGRAM_ADD(histogram, v);
+}
+
+/**
+ * histogram_merge adds every value of another histogram to a histogram
+ * @param histogram - the histogram to add to
+ * @param other - the histogram whose values are added
+ */
+void histogram_merge(WaitHistogram *histogram, const WaitHistogram *other){
+    int i;
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        histogram->buckets[i] += other->buckets[i];
+    }
+}
+
+/**
+ * histogram_percentile gets a percentile of the values of a histogram, as the largest value of the bucket that holds
+ * it, so the true percentile is never above the answer and is within 1 part in HISTOGRAM_SUB_BUCKETS / 2 of it
+ * @param histogram - the histogram
+ * @param percentile - the percentile to get, between 0 and 100
+ * @return - the percentile, or 0 if the histogram is empty
+ */
+int histogram_percentile(const WaitHistogram *histogram, double percentile){
+    unsigned long long count = 0;
+    unsigned long long seen = 0;
+    int i;
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        count += histogram->buckets[i];
+    }
+    if(count == 0){
+        return 0;
+    }
+    /* the rank of the value that is wanted, counting from 1 */
+    double rank = percentile / 100.0 * (double)count;
+    unsigned long long wanted = (unsigned long long)rank;
+    if((double)wanted < rank || wanted == 0){
+        wanted++;
+    }
+    if(wanted > count){
+        wanted = count;
+    }
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        seen += histogram->buckets[i];
+        if(seen >= wanted){
+            return histogram_highest(i);
+        }
+    }
+    return histogram_highest(HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * histogram_record_start empties the total and starts recording the waiting times of the simulations run from now on
+ */
+void histogram_record_start(){
+    histogram_init(&totalHistograms.side[HISTOGRAM_LHS]);
+    histogram_init(&totalHistograms.side[HISTOGRAM_RHS]);
+    recordFailed = 0;
+    recording = 1;
+}
+
+/**
+ * histogram_record_finish stops recording and gets the histograms of every simulation run since recording started,
+ * every other thread must have called histogram_thread_done already
+ * @param total - receives the histograms, merged over every thread and replication
+ * @return - an integer to state whether every vehicle was recorded(0) or a thread had no memory for its histograms(1)
+ */
+int histogram_record_finish(WaitHistograms *total){
+    histogram_thread_done();
+    recording = 0;
+    *total = totalHistograms;
+    return recordFailed;
+}
+
+/**
+ * histogram_thread_buffer gets the calling thread's histograms, making them if needed
+ * @return - pointer to the histograms, or NULL when not recording (or there was no memory for them)
+ */
+WaitHistograms *histogram_thread_buffer(){
+    if(recording == 0){
+        return NULL;
+    }
+    if(threadHistograms == NULL){
+        threadHistograms = (WaitHistograms*) calloc(1, sizeof(WaitHistograms));
+        if(threadHistograms == NULL){
+            recordFailed = 1;
+        }
+    }
+    return threadHistograms;
+}
+
+/**
+ * histogram_thread_done merges the calling thread's histograms into the total and frees them, called by every thread
+ * that may have recorded before it exits
+ */
+void histogram_thread_done(){
+    if(threadHistograms != NULL){
+        pthread_mutex_lock(&histogramLock);
+        histogram_merge(&totalHistograms.side[HISTOGRAM_LHS], &threadHistograms->side[HISTOGRAM_LHS]);
+        histogram_merge(&totalHistograms.side[HISTOGRAM_RHS], &threadHistograms->side[HISTOGRAM_RHS]);
+        pthread_mutex_unlock(&histogramLock);
+        free(threadHistograms);
+        threadHistograms = NULL;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef ECM2433___CW_SIMHISTOGRAM_H
+#define ECM2433___CW_SIMHISTOGRAM_H
+
+/*
+ * simHistogram keeps log-bucketed (HDR style) histograms of the waiting times of the vehicles, for percentiles.
+ *
+ * Values below HISTOGRAM_SUB_BUCKETS get a bucket each, and every power of two above that is split into
+ * HISTOGRAM_SUB_BUCKETS / 2 buckets, so a value is known to within 1 part in HISTOGRAM_SUB_BUCKETS / 2 and every
+ * non-negative int fits in HISTOGRAM_BUCKETS buckets. Adding a value is O(1) with no allocation, and two histograms
+ * are merged by adding their buckets, so the result does not depend on the order they are merged in.
+ *
+ * While recording, each thread adds the vehicles of every replication it runs to its own pair of histograms, which
+ * are merged into the total when the thread runs out of tasks (histogram_thread_done), so recording takes no locks.
+*/
+
+/* The bits of precision of a histogram, and the number of exact buckets that they give */
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+
+/* The number of buckets needed to hold every non-negative int */
+#define HISTOGRAM_BUCKETS ((33 - HISTOGRAM_SUB_BITS) << (HISTOGRAM_SUB_BITS - 1))
+
+/* The shift that keeps the top HISTOGRAM_SUB_BITS bits of an unsigned int v, or 0 when v has no more bits than that */
+#define HISTOGRAM_SHIFT(v) (__builtin_clz((v) | 1) < 32 - HISTOGRAM_SUB_BITS \
+                            ? 32 - HISTOGRAM_SUB_BITS - __builtin_clz((v) | 1) : 0)
+
+/* The bucket of an unsigned int v, worked out without a branch, v is used more than once */
+#define HISTOGRAM_BUCKET(v) ((HISTOGRAM_SHIFT(v) << (HISTOGRAM_SUB_BITS - 1)) + (int)((v) >> HISTOGRAM_SHIFT(v)))
+
+/* Add an unsigned int v to a histogram, for the loops of the simulations where histogram_add would cost a call */
+#define HISTOGRAM_ADD(histogram, v) ((histogram)->buckets[HISTOGRAM_BUCKET(v)]++)
+
+/* The lights of a pair of histograms */
+#define HISTOGRAM_LHS 0
+#define HISTOGRAM_RHS 1
+
+/* The struct Hist, aka WaitHistogram, is the histogram of the waiting times at one light
+ * buckets - the number of values in each bucket, whose total is the number of values added */
+typedef struct Hist {
+    unsigned long long buckets[HISTOGRAM_BUCKETS];
+}WaitHistogram;
+
+/* The struct Hists, aka WaitHistograms, holds the histograms of both lights, indexed by HISTOGRAM_LHS and _RHS */
+typedef struct Hists {
+    WaitHistogram side[2];
+}WaitHistograms;
+
+/* Declare the functions of simHistogram.c */
+void histogram_init(WaitHistogram *histogram);
+void histogram_add(WaitHistogram *histogram, int value);
+void histogram_merge(WaitHistogram *histogram, const WaitHistogram *other);
+int histogram_percentile(const WaitHistogram *histogram, double percentile);
+void histogram_record_start();
+int histogram_record_finish(WaitHistograms *total);
+WaitHistograms *histogram_thread_buffer();
+void histogram_thread_done();
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include "simLibrary.h"
+/* Include the simulator itself and the defaults of runSimulations, which users of the library don't need */
+#include "runOneSimulation.h"
+#include "runSimulations.h"
+
+/**
+ * default_allocate is the allocator used when none is given, it calls malloc
+ * @param size - the number of bytes to allocate
+ * @param user - unused
+ * @return - pointer to the memory, or NULL
+ */
+static void *default_allocate(size_t size, void *user){
+    (void)user;
+    return malloc(size);
+}
+
+/**
+ * default_release frees memory from default_allocate
+ * @param ptr - the memory to free
+ * @param user - unused
+ */
+static void default_release(void *ptr, void *user){
+    (void)user;
+    free(ptr);
+}
+
+/**
+ * sim_default_settings fills in the settings used by runSimulations: a seed of 0, the tick engine, plain variates,
+ * ARRIVAL_ITERATIONS arrival iterations, NUM_REPLICATIONS replications and malloc
+ * @param settings - the settings to fill in
+ */
+void sim_default_settings(SimSettings *settings){
+    settings->seed = 0;
+    settings->engine = ENGINE_TICK;
+    settings->variates = VARIATES_PLAIN;
+    settings->horizon = ARRIVAL_ITERATIONS;
+    settings->replications = NUM_REPLICATIONS;
+    settings->allocator.allocate = default_allocate;
+    settings->allocator.release = default_release;
+    settings->allocator.user = NULL;
+}
+
+/**
+ * sim_context_create creates a context, allocating all of the memory its simulations will need
+ * At most one vehicle arrives at each light per arrival iteration, so queues of horizon vehicles can never fill up
+ * @param settings - the settings of the context, or NULL for the defaults
+ * @return - pointer to the context, or NULL if the settings are not valid or the allocation failed
+ */
+SimContext *sim_context_create(const SimSettings *settings){
+    SimSettings defaults;
+    if(settings == NULL){
+        sim_default_settings(&defaults);
+        settings = &defaults;
+    }
+    if(settings->horizon < 0 || settings->horizon > (1 << 29) || settings->replications < 1
+                             || settings->allocator.allocate == NULL || settings->allocator.release == NULL){
+        return NULL;
+    }
+    SimContext *context = (SimContext*) settings->allocator.allocate(sizeof(SimContext), settings->allocator.user);
+    if(context == NULL){
+        return NULL;
+    }
+    context->settings = *settings;
+
+    /* the ring buffers index with a mask, so round the capacity up to a power of 2 */
+    context->capacity = 1;
+    while(context->capacity < settings->horizon + 1){
+        context->capacity *= 2;
+    }
+    context->queues = (struct Vehicle*) settings->allocator.allocate(sizeof(struct Vehicle) * 2 * context->capacity,
+                                                                     settings->allocator.user);
+    if(context->queues == NULL){
+        settings->allocator.release(context, settings->allocator.user);
+        return NULL;
+    }
+    return context;
+}
+
+/**
+ * sim_context_destroy frees a context and its memory
+ * @param context - the context, can be NULL
+ */
+void sim_context_destroy(SimContext *context){
+    if(context == NULL){
+        return;
+    }
+    SimAllocator allocator = context->settings.allocator;
+    allocator.release(context->queues, allocator.user);
+    allocator.release(context, allocator.user);
+}
+
+/**
+ * sim_run runs a single replication of a configuration
+ * @param context - the context to run in, which must not be in use by another thread
+ * @param config - the configuration to simulate, light periods below 1 are not valid as the lights would never let
+ *                 a vehicle through
+ * @param replication - the replication to run, which selects its random stream
+ * @param result - receives the result of the replication
+ * @return - an integer to state whether the simulation was successful(0) or not(1), result has the status 0 if not
+ */
+int sim_run(SimContext *context, const SimConfig *config, unsigned long replication, ReturnData *result){
+    ReturnData failed = {0,0,0,0,0,0,0,0,0};
+    *result = failed;
+    if(config->lightPeriodLHS < 1 || config->lightPeriodRHS < 1){
+        return 1;
+    }
+
+    /* set up both lights on the context's queues */
+    struct Lights leftLight, rightLight;
+    init_lights(&leftLight, config->lightPeriodLHS, 0);
+    init_lights(&rightLight, config->lightPeriodRHS, 1);
+    leftLight.queue = context->queues;
+    leftLight.capacity = context->capacity;
+    rightLight.queue = context->queues + context->capacity;
+    rightLight.capacity = context->capacity;
+
+    *result = run_junction(&leftLight, &rightLight, config->arrivalRateLHS, config->arrivalRateRHS,
+                           context->settings.seed, replication, context->settings.engine,
+                           context->settings.variates, context->settings.horizon);
+    return 0;
+}
+
+/**
+ * sim_run_batch runs context->settings.replications replications of each of an array of configurations
+ * @param context - the context to run in, which must not be in use by another thread
+ * @param configs - the configurations to simulate
+ * @param count - the number of configurations
+ * @param results - receives the mean result of each configuration, in the same order
+ * @return - an integer to state whether every configuration was simulated(0) or not(1), the results of those that
+ *           were not have the status 0
+ */
+int sim_run_batch(SimContext *context, const SimConfig *configs, long count, ReturnData *results){
+    int failed = 0;
+    long i, replication;
+    for(i = 0; i < count; i++){
+        ResultStats stats;
+        results_init(&stats);
+        for(replication = 0; replication < context->settings.replications; replication++){
+            ReturnData res;
+            if(sim_run(context, &configs[i], replication, &res) == 1){
+                break;
+            }
+            results_add(&stats, res);
+        }
+        /* results_mean gives the status 0 if no replication could be run */
+        results[i] = results_mean(&stats);
+        failed |= results[i].status == 0;
+    }
+    return failed;
+}
@@ -0,0 +1,74 @@
+#ifndef ECM2433___CW_SIMLIBRARY_H
+#define ECM2433___CW_SIMLIBRARY_H
+
+/*
+ * simLibrary is the public API of libsim, the simulator packaged as a static (libsim.a) or shared (libsim.so) library
+ * so that other programs can run simulations without starting a process per query.
+ *
+ * Everything a simulation needs is held in a SimContext, there is no global state. A context may be used by one
+ * thread at a time, so threads running simulations side by side each create their own context. Once a context has
+ * been created, sim_run and sim_run_batch never allocate memory.
+ *
+ * Example:
+ *     SimSettings settings;
+ *     sim_default_settings(&settings);
+ *     settings.seed = 42;
+ *     SimContext *context = sim_context_create(&settings);
+ *     SimConfig config = {50, 5, 40, 6};
+ *     ReturnData res;
+ *     sim_run_batch(context, &config, 1, &res);
+ *     sim_context_destroy(context);
+*/
+
+#include <stddef.h>
+/* Include the public types for the SimConfig and ReturnData structs and the ENGINE_ and VARIATES_ values, which is
+ * all that users of the library need besides this header */
+#include "simTypes.h"
+
+/* The vehicles of a context's queues, which are only used inside the library */
+struct Vehicle;
+
+/* The struct Alloc, aka SimAllocator, is the memory allocator a context uses
+ * void *(*allocate)(size_t size, void *user) - returns size bytes of memory, or NULL
+ * void (*release)(void *ptr, void *user) - frees memory returned by allocate
+ * void *user - passed to both functions */
+typedef struct Alloc {
+    void *(*allocate)(size_t size, void *user);
+    void (*release)(void *ptr, void *user);
+    void *user;
+}SimAllocator;
+
+/* The struct Settings, aka SimSettings, holds the options of a context
+ * unsigned long seed - the master seed, replication i always uses stream i of this seed
+ * int engine - ENGINE_TICK or ENGINE_EVENT
+ * int variates - VARIATES_PLAIN, or the VARIATES_ flags of simTypes.h
+ * int horizon - the number of iterations where vehicles are allowed to arrive, 500 by default
+ * long replications - the number of replications sim_run_batch averages for each configuration
+ * SimAllocator allocator - the allocator used to create the context */
+typedef struct Settings {
+    unsigned long seed;
+    int engine;
+    int variates;
+    int horizon;
+    long replications;
+    SimAllocator allocator;
+}SimSettings;
+
+/* The struct Context, aka SimContext, is the state of the simulations of one thread, created by sim_context_create
+ * SimSettings settings - the settings the context was created with
+ * struct Vehicle *queues - space for the queues of both lights, each big enough for every vehicle of a run
+ * int capacity - the number of vehicles each queue holds, a power of 2 */
+typedef struct Context {
+    SimSettings settings;
+    struct Vehicle *queues;
+    int capacity;
+}SimContext;
+
+/* Declare the functions of simLibrary.c */
+void sim_default_settings(SimSettings *settings);
+SimContext *sim_context_create(const SimSettings *settings);
+void sim_context_destroy(SimContext *context);
+int sim_run(SimContext *context, const SimConfig *config, unsigned long replication, ReturnData *result);
+int sim_run_batch(SimContext *context, const SimConfig *configs, long count, ReturnData *results);
+
+#endif
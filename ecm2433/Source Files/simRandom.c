@@ -0,0 +1,149 @@
+#include "simRandom.h"
+#include "simCounters.h"
+
+/* the multipliers and key increments (Weyl constants) of the Philox4x32 generator */
+#define PHILOX_M0 0xD2511F53UL
+#define PHILOX_M1 0xCD9E8D57UL
+#define PHILOX_W0 0x9E3779B9UL
+#define PHILOX_W1 0xBB67AE85UL
+
+/**
+ * philox_block runs the 10 rounds of Philox4x32 on a counter block and writes the 4 random words to out
+ * @param counter - the 4 word counter to be encrypted
+ * @param key - the 2 word key of the stream
+ * @param out - array that receives the 4 random words
+ */
+static void philox_block(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]){
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    int round;
+    for(round = 0; round < 10; round++){
+        /* multiply the two even words by the round multipliers, keeping both halves of the 64 bit product */
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        /* mix the products with the odd words and the key */
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        /* bump the key for the next round */
+        k0 += (uint32_t)PHILOX_W0;
+        k1 += (uint32_t)PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/**
+ * sim_random_init sets up a random stream for a master seed and a stream index
+ * @param rng - pointer to the stream to initialise
+ * @param seed - the master seed shared by every stream of a run
+ * @param stream - the index of this stream (normally the replication number)
+ */
+void sim_random_init(SimRandom *rng, unsigned long seed, unsigned long stream){
+    /* the seed becomes the key, so different seeds give unrelated sequences */
+    rng->key[0] = (uint32_t)seed;
+    rng->key[1] = (uint32_t)((uint64_t)seed >> 32);
+    /* the low half of the counter counts draws, the high half holds the stream index */
+    rng->counter[0] = 0;
+    rng->counter[1] = 0;
+    rng->counter[2] = (uint32_t)stream;
+    rng->counter[3] = (uint32_t)((uint64_t)stream >> 32);
+    /* mark the output buffer as used up so the first draw generates a block */
+    rng->used = 4;
+}
+
+/**
+ * sim_random_next gets the next raw 32 bit word of the stream
+ * @param rng - pointer to the stream to draw from
+ * @return - a uniformly distributed 32 bit integer
+ */
+uint32_t sim_random_next(SimRandom *rng){
+    /* if every word of the last block has been handed out, generate a new block */
+    COUNT(rngDraws);
+    if(rng->used == 4){
+        philox_block(rng->counter, rng->key, rng->output);
+        /* increment the 64 bit draw counter */
+        rng->counter[0]++;
+        if(rng->counter[0] == 0){
+            rng->counter[1]++;
+        }
+        rng->used = 0;
+    }
+    return rng->output[rng->used++];
+}
+
+/**
+ * sim_random_fill gets the next count raw 32 bit words of the stream, the same words count calls of sim_random_next
+ * would give, but whole blocks are written straight to words without going through the output buffer
+ * @param rng - pointer to the stream to draw from
+ * @param words - array that receives the random words
+ * @param count - the number of words to draw
+ */
+void sim_random_fill(SimRandom *rng, uint32_t *words, int count){
+    int i = 0;
+    /* hand out what is left of the last block first */
+    while(i < count && rng->used < 4){
+        COUNT(rngDraws);
+        words[i++] = rng->output[rng->used++];
+    }
+    /* then encrypt whole counter blocks directly into words */
+    while(count - i >= 4){
+        COUNT_ADD(rngDraws, 4);
+        philox_block(rng->counter, rng->key, words + i);
+        rng->counter[0]++;
+        if(rng->counter[0] == 0){
+            rng->counter[1]++;
+        }
+        i += 4;
+    }
+    /* and take any remaining words one at a time */
+    while(i < count){
+        words[i++] = sim_random_next(rng);
+    }
+}
+
+/**
+ * sim_random_skip moves the stream on past its next count words without working them out, so the words after them are
+ * the same as if they had been drawn
+ * @param rng - pointer to the stream to move on
+ * @param count - the number of words to skip
+ */
+void sim_random_skip(SimRandom *rng, int count){
+    /* skip what is left of the last block first */
+    int left = 4 - rng->used;
+    if(count <= left){
+        rng->used += count;
+        return;
+    }
+    count -= left;
+    /* then move the counter on past the whole blocks, which is all a block is */
+    uint32_t blocks = (uint32_t)(count / 4);
+    rng->counter[0] += blocks;
+    if(rng->counter[0] < blocks){
+        rng->counter[1]++;
+    }
+    rng->used = 4;
+    /* and draw the block holding the last words skipped, as its remaining words come next */
+    if(count % 4 != 0){
+        philox_block(rng->counter, rng->key, rng->output);
+        rng->counter[0]++;
+        if(rng->counter[0] == 0){
+            rng->counter[1]++;
+        }
+        rng->used = count % 4;
+    }
+}
+
+/**
+ * sim_random_uniform gets a double in the range [0, 1) from the stream
+ * @param rng - pointer to the stream to draw from
+ * @return - a uniformly distributed double between 0 (inclusive) and 1 (exclusive)
+ */
+double sim_random_uniform(SimRandom *rng){
+    return sim_random_next(rng) * (1.0 / 4294967296.0);
+}
@@ -0,0 +1,23 @@
+#ifndef ECM2433___CW_SIMRANDOM_H
+#define ECM2433___CW_SIMRANDOM_H
+
+#include <stdint.h>
+
+/* The struct Rng, aka SimRandom, is a counter-based (Philox4x32-10) random stream.
+ * A stream is fully described by its master seed and its stream (replication) index, so any run can be replayed
+ * bit-for-bit and every replication gets an independent stream without sharing any state */
+typedef struct Rng {
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t output[4];
+    int used;
+}SimRandom;
+
+/* Declare the functions of simRandom.c */
+void sim_random_init(SimRandom *rng, unsigned long seed, unsigned long stream);
+uint32_t sim_random_next(SimRandom *rng);
+void sim_random_fill(SimRandom *rng, uint32_t *words, int count);
+void sim_random_skip(SimRandom *rng, int count);
+double sim_random_uniform(SimRandom *rng);
+
+#endif
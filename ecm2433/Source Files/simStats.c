@@ -0,0 +1,200 @@
+#include <math.h>
+#include <string.h>
+#include "simStats.h"
+
+/* The names of the metrics, matching the fields of ReturnData */
+static const char *METRIC_NAMES[NUM_METRICS] = {
+    "avgTimeRHS", "maxTimeRHS", "numOfVehiclesRHS", "clearanceTimeRHS",
+    "avgTimeLHS", "maxTimeLHS", "numOfVehiclesLHS", "clearanceTimeLHS"
+};
+
+/* The two sided 95% critical values of Student's t distribution for 1 to 30 degrees of freedom */
+static const double T_CRITICAL[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/**
+ * stat_init empties an accumulator
+ * @param stat - pointer to the accumulator
+ */
+void stat_init(RunningStat *stat){
+    stat->count = 0;
+    stat->mean = 0;
+    stat->m2 = 0;
+    stat->min = 0;
+    stat->max = 0;
+}
+
+/**
+ * stat_add adds one value to an accumulator using Welford's update, which is stable however many values are added
+ * @param stat - pointer to the accumulator
+ * @param value - the value to add
+ */
+void stat_add(RunningStat *stat, double value){
+    stat->count++;
+    double delta = value - stat->mean;
+    stat->mean += delta / stat->count;
+    stat->m2 += delta * (value - stat->mean);
+    if(stat->count == 1 || value < stat->min){
+        stat->min = value;
+    }
+    if(stat->count == 1 || value > stat->max){
+        stat->max = value;
+    }
+}
+
+/**
+ * stat_merge adds every value of another accumulator to an accumulator (Chan's parallel update), so accumulators
+ * filled by different threads can be combined
+ * @param stat - pointer to the accumulator that receives the values
+ * @param other - pointer to the accumulator being merged in
+ */
+void stat_merge(RunningStat *stat, const RunningStat *other){
+    if(other->count == 0){
+        return;
+    }
+    if(stat->count == 0){
+        *stat = *other;
+        return;
+    }
+    long count = stat->count + other->count;
+    double delta = other->mean - stat->mean;
+    stat->mean += delta * other->count / count;
+    stat->m2 += other->m2 + delta * delta * ((double)stat->count * other->count / count);
+    stat->count = count;
+    if(other->min < stat->min){
+        stat->min = other->min;
+    }
+    if(other->max > stat->max){
+        stat->max = other->max;
+    }
+}
+
+/**
+ * stat_variance gets the sample variance of the values in an accumulator
+ * @param stat - pointer to the accumulator
+ * @return - the sample variance, or 0 if there are fewer than 2 values
+ */
+double stat_variance(const RunningStat *stat){
+    if(stat->count < 2){
+        return 0;
+    }
+    return stat->m2 / (stat->count - 1);
+}
+
+/**
+ * stat_half_width gets the half width of the 95% confidence interval of the mean of an accumulator
+ * @param stat - pointer to the accumulator
+ * @return - the half width, or HUGE_VAL if there are fewer than 2 values
+ */
+double stat_half_width(const RunningStat *stat){
+    if(stat->count < 2){
+        return HUGE_VAL;
+    }
+    long df = stat->count - 1;
+    /* beyond the table, 1.96 + 2.5 / df is within 0.002 of the exact value */
+    double t = df <= 30 ? T_CRITICAL[df - 1] : 1.96 + 2.5 / df;
+    return t * sqrt(stat_variance(stat) / stat->count);
+}
+
+/**
+ * results_init empties the accumulators of every metric
+ * @param stats - pointer to the accumulators
+ */
+void results_init(ResultStats *stats){
+    int metric;
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        stat_init(&stats->metrics[metric]);
+    }
+}
+
+/**
+ * results_add adds the result of one replication to the accumulators, results with the status 0 are discarded
+ * @param stats - pointer to the accumulators
+ * @param res - the result of the replication
+ */
+void results_add(ResultStats *stats, ReturnData res){
+    int metric;
+    if(res.status == 0){
+        return;
+    }
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        stat_add(&stats->metrics[metric], get_metric(res, metric));
+    }
+}
+
+/**
+ * results_merge merges the accumulators of every metric of other into stats
+ * @param stats - pointer to the accumulators that receive the values
+ * @param other - pointer to the accumulators being merged in
+ */
+void results_merge(ResultStats *stats, const ResultStats *other){
+    int metric;
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        stat_merge(&stats->metrics[metric], &other->metrics[metric]);
+    }
+}
+
+/**
+ * results_mean gets the mean of every metric as a ReturnData struct
+ * @param stats - pointer to the accumulators
+ * @return - the means, with the status 1 if any results were added and 0 if not
+ */
+ReturnData results_mean(const ResultStats *stats){
+    const RunningStat *m = stats->metrics;
+    ReturnData res = {m[METRIC_AVG_TIME_RHS].mean,
+                      m[METRIC_MAX_TIME_RHS].mean,
+                      m[METRIC_NUM_OF_VEHICLES_RHS].mean,
+                      m[METRIC_CLEARANCE_TIME_RHS].mean,
+                      m[METRIC_AVG_TIME_LHS].mean,
+                      m[METRIC_MAX_TIME_LHS].mean,
+                      m[METRIC_NUM_OF_VEHICLES_LHS].mean,
+                      m[METRIC_CLEARANCE_TIME_LHS].mean,
+                      m[0].count > 0};
+    return res;
+}
+
+/**
+ * get_metric gets one field of a ReturnData struct by its METRIC_ index
+ * @param res - the ReturnData struct
+ * @param metric - the METRIC_ index of the field
+ * @return - the value of the field
+ */
+double get_metric(ReturnData res, int metric){
+    switch(metric){
+        case METRIC_AVG_TIME_RHS: return res.avgTimeRHS;
+        case METRIC_MAX_TIME_RHS: return res.maxTimeRHS;
+        case METRIC_NUM_OF_VEHICLES_RHS: return res.numOfVehiclesRHS;
+        case METRIC_CLEARANCE_TIME_RHS: return res.clearanceTimeRHS;
+        case METRIC_AVG_TIME_LHS: return res.avgTimeLHS;
+        case METRIC_MAX_TIME_LHS: return res.maxTimeLHS;
+        case METRIC_NUM_OF_VEHICLES_LHS: return res.numOfVehiclesLHS;
+        default: return res.clearanceTimeLHS;
+    }
+}
+
+/**
+ * find_metric looks up a metric by the name of its ReturnData field
+ * @param name - the name of the field, e.g. "avgTimeLHS"
+ * @return - the METRIC_ index, or -1 if there is no such field
+ */
+int find_metric(const char *name){
+    int metric;
+    for(metric = 0; metric < NUM_METRICS; metric++){
+        if(strcmp(name, METRIC_NAMES[metric]) == 0){
+            return metric;
+        }
+    }
+    return -1;
+}
+
+/**
+ * metric_name gets the name of a metric
+ * @param metric - the METRIC_ index
+ * @return - the name of its ReturnData field
+ */
+const char *metric_name(int metric){
+    return METRIC_NAMES[metric];
+}
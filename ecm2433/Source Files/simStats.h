@@ -0,0 +1,50 @@
+#ifndef ECM2433___CW_SIMSTATS_H
+#define ECM2433___CW_SIMSTATS_H
+
+/* Include the runOneSimulation header file for the ReturnData struct */
+#include "runOneSimulation.h"
+
+/* The fields of ReturnData that statistics are kept for, in the order they appear in ReturnData */
+#define METRIC_AVG_TIME_RHS 0
+#define METRIC_MAX_TIME_RHS 1
+#define METRIC_NUM_OF_VEHICLES_RHS 2
+#define METRIC_CLEARANCE_TIME_RHS 3
+#define METRIC_AVG_TIME_LHS 4
+#define METRIC_MAX_TIME_LHS 5
+#define METRIC_NUM_OF_VEHICLES_LHS 6
+#define METRIC_CLEARANCE_TIME_LHS 7
+#define NUM_METRICS 8
+
+/* The struct Acc, aka RunningStat, is a streaming (Welford) accumulator of one value
+ * long count - the number of values added
+ * double mean - the mean of the values
+ * double m2 - the sum of squared differences from the mean, the variance is m2 / (count - 1)
+ * double min / max - the smallest and largest values added */
+typedef struct Acc {
+    long count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+}RunningStat;
+
+/* The struct Stats, aka ResultStats, holds a RunningStat for every field of ReturnData, indexed by the METRIC_ values */
+typedef struct Stats {
+    RunningStat metrics[NUM_METRICS];
+}ResultStats;
+
+/* Declare the functions of simStats.c */
+void stat_init(RunningStat *stat);
+void stat_add(RunningStat *stat, double value);
+void stat_merge(RunningStat *stat, const RunningStat *other);
+double stat_variance(const RunningStat *stat);
+double stat_half_width(const RunningStat *stat);
+void results_init(ResultStats *stats);
+void results_add(ResultStats *stats, ReturnData res);
+void results_merge(ResultStats *stats, const ResultStats *other);
+ReturnData results_mean(const ResultStats *stats);
+double get_metric(ReturnData res, int metric);
+int find_metric(const char *name);
+const char *metric_name(int metric);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+#include "simTrace.h"
+
+/* the open trace file, or NULL when not tracing, and the lock held while a block is written to it */
+static FILE *traceFile = NULL;
+static int traceFailed = 0;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the buffer of this thread, made the first time the thread traces a vehicle */
+static __thread struct TraceBuffer *threadBuffer = NULL;
+
+/**
+ * trace_open creates a trace file and starts tracing every simulation run after this call
+ * @param path - the path of the file to create
+ * @return - an integer to state whether the file was created(0) or not(1)
+ */
+int trace_open(const char *path){
+    TraceHeader header;
+    traceFile = fopen(path, "wb");
+    if(traceFile == NULL){
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    traceFailed = fwrite(&header, sizeof(header), 1, traceFile) != 1;
+    return traceFailed;
+}
+
+/**
+ * trace_write_block appends a thread's buffer to the trace file as one block, then empties the buffer
+ * @param buffer - the buffer to write out
+ */
+static void trace_write_block(struct TraceBuffer *buffer){
+    static const char padding[8] = {0};
+    TraceBlock block;
+    size_t count = (size_t)buffer->count;
+    if(count == 0){
+        return;
+    }
+    block.count = (uint32_t)count;
+    block.reserved = 0;
+    pthread_mutex_lock(&traceLock);
+    if(fwrite(&block, sizeof(block), 1, traceFile) != 1
+       || fwrite(buffer->arrival, sizeof(int32_t), count, traceFile) != count
+       || fwrite(buffer->departure, sizeof(int32_t), count, traceFile) != count
+       || fwrite(buffer->replications, sizeof(uint32_t), count, traceFile) != count
+       || fwrite(buffer->light, sizeof(uint8_t), count, traceFile) != count
+       || fwrite(padding, 1, (8 - count % 8) % 8, traceFile) != (8 - count % 8) % 8){
+        traceFailed = 1;
+    }
+    pthread_mutex_unlock(&traceLock);
+    buffer->count = 0;
+}
+
+/**
+ * trace_thread_buffer gets the calling thread's buffer, making it if needed
+ * @return - pointer to the buffer, or NULL when not tracing (or there was no memory for a buffer)
+ */
+struct TraceBuffer *trace_thread_buffer(){
+    if(traceFile == NULL){
+        return NULL;
+    }
+    if(threadBuffer == NULL){
+        threadBuffer = (struct TraceBuffer*) malloc(sizeof(struct TraceBuffer));
+        if(threadBuffer == NULL){
+            traceFailed = 1;
+            return NULL;
+        }
+        threadBuffer->count = 0;
+    }
+    return threadBuffer;
+}
+
+/**
+ * trace_add adds a vehicle to a thread's buffer, writing the buffer out as a block when it is full
+ * @param buffer - the thread's buffer
+ * @param light - TRACE_LHS or TRACE_RHS
+ * @param arrival - the iteration the vehicle arrived at
+ * @param departure - the iteration the vehicle passed the light
+ */
+void trace_add(struct TraceBuffer *buffer, int light, int arrival, int departure){
+    int i = buffer->count++;
+    buffer->arrival[i] = arrival;
+    buffer->departure[i] = departure;
+    buffer->replications[i] = buffer->replication;
+    buffer->light[i] = (uint8_t)light;
+    if(buffer->count == TRACE_BLOCK_RECORDS){
+        trace_write_block(buffer);
+    }
+}
+
+/**
+ * trace_thread_done writes out and frees the calling thread's buffer, called by every thread that may have traced
+ * before it exits
+ */
+void trace_thread_done(){
+    if(threadBuffer != NULL){
+        trace_write_block(threadBuffer);
+        free(threadBuffer);
+        threadBuffer = NULL;
+    }
+}
+
+/**
+ * trace_close writes out the calling thread's buffer and closes the trace file, every other thread must have called
+ * trace_thread_done already
+ * @return - an integer to state whether the whole trace was written(0) or not(1)
+ */
+int trace_close(){
+    if(traceFile == NULL){
+        return 0;
+    }
+    trace_thread_done();
+    int failed = fclose(traceFile) != 0 || traceFailed;
+    traceFile = NULL;
+    traceFailed = 0;
+    return failed;
+}
@@ -0,0 +1,68 @@
+#ifndef ECM2433___CW_SIMTRACE_H
+#define ECM2433___CW_SIMTRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * simTrace writes a record of every vehicle that passes through the lights to a binary file, for auditing results.
+ *
+ * The file starts with a TraceHeader, followed by blocks of up to TRACE_BLOCK_RECORDS records. Each block is a
+ * TraceBlock followed by its columns, one after the other:
+ *     int32_t arrival[count] - the iteration each vehicle arrived at
+ *     int32_t departure[count] - the iteration each vehicle passed the light
+ *     uint32_t replication[count] - the replication each vehicle was in
+ *     uint8_t light[count] - the light each vehicle was at, TRACE_LHS or TRACE_RHS
+ * padded with zeros to a multiple of 8 bytes. All values are in the byte order of the machine that wrote the file.
+ *
+ * Each thread fills its own buffer and writes it out as a whole block when it is full, so tracing takes no locks
+ * per vehicle. The blocks of different threads are interleaved in the file, so the records are in no particular order.
+*/
+
+/* The number of records in a full block */
+#define TRACE_BLOCK_RECORDS 65536
+
+/* The lights a record can be at */
+#define TRACE_LHS 0
+#define TRACE_RHS 1
+
+/* The magic bytes and format version at the start of a trace file */
+#define TRACE_MAGIC "SIMTRACE"
+#define TRACE_VERSION 1
+
+/* The struct TraceHead, aka TraceHeader, is the first 16 bytes of a trace file */
+typedef struct TraceHead {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+}TraceHeader;
+
+/* The struct TraceBlk, aka TraceBlock, starts each block of records */
+typedef struct TraceBlk {
+    uint32_t count;
+    uint32_t reserved;
+}TraceBlock;
+
+/*
+ * TraceBuffer is the block of records a thread is filling
+ * uint32_t replication - the replication of the simulation currently being traced by the thread
+ * int count - the number of records in the buffer
+*/
+struct TraceBuffer {
+    uint32_t replication;
+    int count;
+    int32_t arrival[TRACE_BLOCK_RECORDS];
+    int32_t departure[TRACE_BLOCK_RECORDS];
+    uint32_t replications[TRACE_BLOCK_RECORDS];
+    uint8_t light[TRACE_BLOCK_RECORDS];
+};
+
+/* Declare the functions of simTrace.c */
+int trace_open(const char *path);
+int trace_close();
+struct TraceBuffer *trace_thread_buffer();
+void trace_thread_done();
+void trace_add(struct TraceBuffer *buffer, int light, int arrival, int departure);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ECM2433___CW_SIMTYPES_H
+#define ECM2433___CW_SIMTYPES_H
+
+/*
+ * simTypes holds the types and constants that callers of the simulator need, on their own so that the public header
+ * of libsim (simLibrary.h) does not pull in the rest of the program's headers
+*/
+
+/* The struct Res, aka ReturnData creates a neat and usable datatype to allow the
+ * required data to be returned by the runOneSimulation in runOneSimulation.c*/
+typedef struct Res {
+    float avgTimeRHS;
+    float maxTimeRHS;
+    float numOfVehiclesRHS;
+    float clearanceTimeRHS;
+    float avgTimeLHS;
+    float maxTimeLHS;
+    float numOfVehiclesLHS;
+    float clearanceTimeLHS;
+    float status;
+}ReturnData;
+
+/* The struct Cfg, aka SimConfig, holds the four parameters of one simulated junction */
+typedef struct Cfg {
+    int arrivalRateLHS;
+    int lightPeriodLHS;
+    int arrivalRateRHS;
+    int lightPeriodRHS;
+}SimConfig;
+
+/* The engines that runOneSimulation can use, ENGINE_TICK runs every iteration and ENGINE_EVENT skips idle iterations */
+#define ENGINE_TICK 0
+#define ENGINE_EVENT 1
+
+/* How runOneSimulation draws its arrivals, used to reduce the variance of comparisons between configurations
+ * VARIATES_PLAIN - the usual draws, where a light whose arrival rate is 0 or 100 draws nothing as its arrivals are certain
+ * VARIATES_SYNCED - a flag to draw for both lights on every arrival iteration, so a replication's draws line up by
+ *                   iteration across configurations with different arrival rates and light periods (common random
+ *                   numbers)
+ * VARIATES_ANTITHETIC - a flag to use 1 - u in place of every draw u, giving the antithetic twin of a replication */
+#define VARIATES_PLAIN 0
+#define VARIATES_SYNCED 1
+#define VARIATES_ANTITHETIC 2
+
+#endif
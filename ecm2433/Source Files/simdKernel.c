@@ -0,0 +1,837 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <immintrin.h>
+#include "simdKernel.h"
+#include "simHistogram.h"
+#include "simCounters.h"
+
+/*
+ * simdKernel runs the tick engine of runOneSimulation for 8 (AVX2) or 16 (AVX-512) replications of the same
+ * configuration at once, one replication per vector lane.
+ * As every lane runs the same configuration, the light timer and which light is green are the same in every lane and
+ * are kept as plain integers; the random streams, arrival tests, queues and statistics are kept one per lane.
+ * Each lane draws from the same Philox stream, in the same order, as runOneSimulation would for its replication: the
+ * arrivals of a block of ARRIVAL_BLOCK iterations are drawn together and kept as one mask of lanes per iteration, so the
+ * lanes make the same arrival decisions and the results are identical to the scalar engine. A light below
+ * ARRIVAL_SPARSE_THRESHOLD still has all the words of its block worked out in vector lanes, and then each lane places
+ * its arrivals from the gaps drawn from the first of its words, as arrival_mask does.
+ * Queues never hold more than max vehicles (at most one arrival per iteration), so each lane's queue is a plain array
+ * indexed by how many vehicles have arrived (tail) and departed (head), stored interleaved as slot * lanes + lane.
+*/
+
+/* the multipliers and key increments of the Philox4x32 generator, which must match simRandom.c */
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+/*
+ * Batch holds the parameters shared by every lane of a batch
+ * uint64_t threshold[2] - the arrival_threshold of the right (0) and left (1) lights
+ * double logMiss[2] - the arrival_log_miss of each light whose threshold is below ARRIVAL_SPARSE_THRESHOLD
+ * int recordWaits - 1 if each vehicle's waiting time is written over its arrival in the queue as it passes, so that
+ *                   record_avx2 or record_avx512 can add them to a histogram once the kernel has finished
+*/
+struct Batch {
+    int lightPeriodLHS;
+    int lightPeriodRHS;
+    uint64_t threshold[2];
+    double logMiss[2];
+    int recordWaits;
+    uint32_t key[2];
+    uint32_t replication[SIMD_MAX_LANES][2];
+    int max;
+    int used;
+};
+
+/*
+ * LaneStats holds the statistics of every lane once a kernel has finished, ready to be turned into ReturnData
+ * int blocks - the blocks of ARRIVAL_BLOCK iterations drawn for each light, the same in every lane
+ * int highWaterRHS / highWaterLHS - the longest each lane's queues have been, only kept with -DSIM_COUNTERS
+*/
+struct LaneStats {
+    float avgTimeRHS[SIMD_MAX_LANES];
+    int maxTimeRHS[SIMD_MAX_LANES];
+    int numOfVehiclesRHS[SIMD_MAX_LANES];
+    int clearanceTimeRHS[SIMD_MAX_LANES];
+    float avgTimeLHS[SIMD_MAX_LANES];
+    int maxTimeLHS[SIMD_MAX_LANES];
+    int numOfVehiclesLHS[SIMD_MAX_LANES];
+    int clearanceTimeLHS[SIMD_MAX_LANES];
+    int blocks;
+#ifdef SIM_COUNTERS
+    int highWaterRHS[SIMD_MAX_LANES];
+    int highWaterLHS[SIMD_MAX_LANES];
+#endif
+};
+
+/**
+ * certain_arrivals gets the lane mask of every iteration of a light whose arrivals don't need any random words
+ * @param threshold - the arrival threshold of the light
+ * @param all - the lane mask with every lane set
+ * @return - 0 if vehicles never arrive, all if they arrive on every iteration, and -1 if the words are needed
+ */
+static long certain_arrivals(uint64_t threshold, uint32_t all){
+    if(threshold == 0){
+        return 0;
+    }
+    if(threshold > 0xFFFFFFFFU){
+        return all;
+    }
+    return -1;
+}
+
+/**
+ * sparse_arrivals places the arrivals of a light below ARRIVAL_SPARSE_THRESHOLD for one block in every lane, from the
+ * gaps between them, as arrival_mask does for VARIATES_PLAIN, which is the only way a batch is drawn
+ * @param batch - the parameters of the batch
+ * @param side - the light to draw for, 0 for the right light and 1 for the left
+ * @param words - the ARRIVAL_BLOCK words of the block in each lane, stored as word * lanes + lane
+ * @param lanes - the number of lanes
+ * @param arrive - receives the mask of lanes where a vehicle arrives, for each iteration of the block
+ */
+static void sparse_arrivals(struct Batch *batch, int side, const uint32_t *words, int lanes,
+                            uint32_t arrive[ARRIVAL_BLOCK]){
+    int lane, i;
+    for(i = 0; i < ARRIVAL_BLOCK; i++){
+        arrive[i] = 0;
+    }
+    for(lane = 0; lane < lanes; lane++){
+        int drawn = 0;
+        i = 0;
+        while(1){
+            i += arrival_gap(words[drawn * lanes + lane], batch->logMiss[side]);
+            drawn++;
+            if(i >= ARRIVAL_BLOCK){
+                break;
+            }
+            arrive[i] |= (uint32_t)1 << lane;
+            if(++i == ARRIVAL_BLOCK){
+                break;
+            }
+        }
+        /* the scalar engine only draws the words it uses */
+        if(lane < batch->used){
+            COUNT_ADD(rngDraws, drawn);
+        }
+    }
+}
+
+/**
+ * add_buckets adds one value to each of the buckets of a histogram picked by a mask of lanes
+ * @param histogram - the histogram
+ * @param buckets - the bucket of each lane
+ * @param mask - the lanes to add
+ * @param all - the mask of every lane
+ */
+static void add_buckets(WaitHistogram *histogram, const int *buckets, int mask, int all){
+    int lane;
+    if(mask == all){
+        for(lane = 0; all != 0; lane++, all >>= 1){
+            histogram->buckets[buckets[lane]]++;
+        }
+        return;
+    }
+    while(mask != 0){
+        histogram->buckets[buckets[__builtin_ctz(mask)]]++;
+        mask &= mask - 1;
+    }
+}
+
+/**
+ * fill_stats turns the statistics of the lanes into ReturnData results
+ * @param stats - the statistics of each lane
+ * @param count - the number of lanes to copy out
+ * @param results - array that receives one ReturnData per lane
+ */
+static void fill_stats(struct LaneStats *stats, int count, ReturnData *results){
+    int lane;
+    for(lane = 0; lane < count; lane++){
+        ReturnData res = {stats->avgTimeRHS[lane],
+                          stats->maxTimeRHS[lane],
+                          stats->numOfVehiclesRHS[lane],
+                          stats->clearanceTimeRHS[lane],
+                          stats->avgTimeLHS[lane],
+                          stats->maxTimeLHS[lane],
+                          stats->numOfVehiclesLHS[lane],
+                          stats->clearanceTimeLHS[lane],
+                          1};
+        results[lane] = res;
+    }
+}
+
+#ifdef SIM_COUNTERS
+/**
+ * count_lanes adds what the used lanes of a batch simulated to this thread's counters, counting each lane as the
+ * scalar tick engine would have counted its replication
+ * @param batch - the parameters of the batch
+ * @param stats - the statistics of each lane
+ * @param count - the number of lanes used
+ */
+static void count_lanes(struct Batch *batch, struct LaneStats *stats, int count){
+    /* the lights switch on the last iteration of each green period, the right light's first */
+    int cycle = batch->lightPeriodRHS + batch->lightPeriodLHS + 2;
+    int side, lane;
+    for(lane = 0; lane < count; lane++){
+        int clearance = stats->clearanceTimeRHS[lane] > stats->clearanceTimeLHS[lane]
+                        ? stats->clearanceTimeRHS[lane] : stats->clearanceTimeLHS[lane];
+        int ticks = batch->max + 1 + clearance;
+        COUNT_TICKS(0, ticks, batch->max);
+        COUNT_ADD(lightSwitches, 2 * (ticks / cycle) + (ticks % cycle > batch->lightPeriodRHS));
+        COUNT_ADD(arrivalsRHS, stats->numOfVehiclesRHS[lane]);
+        COUNT_ADD(arrivalsLHS, stats->numOfVehiclesLHS[lane]);
+        COUNT_ADD(departuresRHS, stats->numOfVehiclesRHS[lane]);
+        COUNT_ADD(departuresLHS, stats->numOfVehiclesLHS[lane]);
+        COUNT_MAX(highWaterRHS, stats->highWaterRHS[lane]);
+        COUNT_MAX(highWaterLHS, stats->highWaterLHS[lane]);
+        /* sparse lights are counted word by word as they are drawn */
+        for(side = 0; side < 2; side++){
+            if(certain_arrivals(batch->threshold[side], 1) < 0 && batch->threshold[side] >= ARRIVAL_SPARSE_THRESHOLD){
+                COUNT_ADD(rngDraws, (unsigned long long)stats->blocks * ARRIVAL_BLOCK);
+            }
+        }
+    }
+    /* COUNT_START counts the first lane */
+    COUNT_ADD(simulations, count - 1);
+    COUNT_ADD(allocations, 2);
+}
+#endif
+
+/**
+ * mulhi_avx2 gets the high 32 bits of the 64 bit products of each lane of a with the same lane of m
+ * @param a - the 8 values to multiply
+ * @param m - the multiplier in every lane
+ * @return - the high halves of the 8 products
+ */
+__attribute__((target("avx2")))
+static __m256i mulhi_avx2(__m256i a, __m256i m){
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+/**
+ * draw_avx2 draws the arrivals of one light for the next ARRIVAL_BLOCK iterations in all 8 lanes, as arrival_mask does
+ * for each lane's replication, running one Philox block per lane for every 4 iterations
+ * @param batch - the parameters of the batch
+ * @param side - the light to draw for, 0 for the right light and 1 for the left
+ * @param streamLo - the low halves of the stream index of each lane
+ * @param streamHi - the high halves of the stream index of each lane
+ * @param drawCounter - the 64 bit draw counter shared by every lane, which is moved on past the blocks used
+ * @param arrive - receives the mask of lanes where a vehicle arrives, for each iteration of the block
+ */
+__attribute__((target("avx2")))
+static void draw_avx2(struct Batch *batch, int side, __m256i streamLo, __m256i streamHi, uint32_t drawCounter[2],
+                      uint32_t arrive[ARRIVAL_BLOCK]){
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000U);
+    const __m256i m0 = _mm256_set1_epi32((int)PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32((int)PHILOX_M1);
+    long certain = certain_arrivals(batch->threshold[side], 0xFF);
+    int sparse = batch->threshold[side] < ARRIVAL_SPARSE_THRESHOLD;
+    uint32_t sparseWords[ARRIVAL_BLOCK * 8];
+    int block, i;
+    if(certain >= 0){
+        for(i = 0; i < ARRIVAL_BLOCK; i++){
+            arrive[i] = (uint32_t)certain;
+        }
+        return;
+    }
+    /* the threshold is compared as a signed value after flipping the top bit, which gives an unsigned compare */
+    const __m256i threshold = _mm256_xor_si256(_mm256_set1_epi32((int)(uint32_t)batch->threshold[side]), sign);
+    for(block = 0; block < ARRIVAL_BLOCK / 4; block++){
+        __m256i c0 = _mm256_set1_epi32((int)drawCounter[0]);
+        __m256i c1 = _mm256_set1_epi32((int)drawCounter[1]);
+        __m256i c2 = streamLo;
+        __m256i c3 = streamHi;
+        uint32_t k0 = batch->key[0], k1 = batch->key[1];
+        int round;
+        for(round = 0; round < 10; round++){
+            __m256i n0 = _mm256_xor_si256(_mm256_xor_si256(mulhi_avx2(c2, m1), c1), _mm256_set1_epi32((int)k0));
+            __m256i n2 = _mm256_xor_si256(_mm256_xor_si256(mulhi_avx2(c0, m0), c3), _mm256_set1_epi32((int)k1));
+            c1 = _mm256_mullo_epi32(c2, m1);
+            c3 = _mm256_mullo_epi32(c0, m0);
+            c0 = n0;
+            c2 = n2;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        __m256i words[4];
+        words[0] = c0;
+        words[1] = c1;
+        words[2] = c2;
+        words[3] = c3;
+        for(i = 0; i < 4; i++){
+            if(sparse){
+                _mm256_storeu_si256((__m256i*)(sparseWords + (block * 4 + i) * 8), words[i]);
+            }else{
+                arrive[block * 4 + i] = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(
+                        _mm256_cmpgt_epi32(threshold, _mm256_xor_si256(words[i], sign))));
+            }
+        }
+        drawCounter[0]++;
+        if(drawCounter[0] == 0){
+            drawCounter[1]++;
+        }
+    }
+    if(sparse){
+        sparse_arrivals(batch, side, sparseWords, 8, arrive);
+    }
+}
+
+/**
+ * bucket_avx2 works out the histogram bucket of each lane's value, as HISTOGRAM_BUCKET does
+ * @param value - the 8 values, which are never negative
+ * @return - the 8 buckets
+ */
+__attribute__((target("avx2")))
+static __m256i bucket_avx2(__m256i value){
+    const __m256i one = _mm256_set1_epi32(1);
+    /* the highest set bit is the exponent of the value as a float, which is exact below 2^24, and above that is taken
+     * from the value / 256 instead */
+    __m256i low = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_or_si256(value, one)));
+    __m256i high = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_or_si256(_mm256_srli_epi32(value, 8), one)));
+    __m256i top = _mm256_blendv_epi8(_mm256_sub_epi32(_mm256_srli_epi32(low, 23), _mm256_set1_epi32(127)),
+                                     _mm256_sub_epi32(_mm256_srli_epi32(high, 23), _mm256_set1_epi32(127 - 8)),
+                                     _mm256_cmpgt_epi32(value, _mm256_set1_epi32((1 << 24) - 1)));
+    __m256i shift = _mm256_max_epi32(_mm256_sub_epi32(top, _mm256_set1_epi32(HISTOGRAM_SUB_BITS - 1)),
+                                     _mm256_setzero_si256());
+    return _mm256_add_epi32(_mm256_slli_epi32(shift, HISTOGRAM_SUB_BITS - 1), _mm256_srlv_epi32(value, shift));
+}
+
+/**
+ * arrived_avx2 gets the lanes where more than a number of vehicles arrived, those whose queue slot holds a vehicle
+ * @param used - the number of vehicles that arrived in each lane
+ * @param slot - the queue slot
+ * @param all - the mask of the lanes to consider
+ * @return - the mask of the lanes with more than slot vehicles
+ */
+__attribute__((target("avx2")))
+static int arrived_avx2(__m256i used, int slot, int all){
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(used, _mm256_set1_epi32(slot)))) & all;
+}
+
+/**
+ * record_avx2 adds the waiting times that run_avx2 has left in the queues of one light to its histogram
+ * @param histogram - the histogram of the light
+ * @param queue - the queues of the light, holding the waiting time of every vehicle that arrived, which are turned into
+ *                their buckets
+ * @param vehicles - the number of vehicles that arrived in each lane
+ * @param count - the number of lanes to add, the ones whose results are used
+ */
+__attribute__((target("avx2")))
+static void record_avx2(WaitHistogram *histogram, int *queue, const int *vehicles, int count){
+    const __m256i used = _mm256_loadu_si256((const __m256i*)vehicles);
+    int all = (1 << count) - 1;
+    int slot, most;
+    /* turn each waiting time into its bucket first, so that adding them does not wait on the vector stores */
+    for(slot = 0; arrived_avx2(used, slot, all) != 0; slot++){
+        _mm256_storeu_si256((__m256i*)(queue + slot * 8),
+                            bucket_avx2(_mm256_loadu_si256((const __m256i*)(queue + slot * 8))));
+    }
+    most = slot;
+    for(slot = 0; slot < most; slot++){
+        add_buckets(histogram, queue + slot * 8, arrived_avx2(used, slot, all), all);
+    }
+}
+
+/**
+ * run_avx2 runs 8 lanes of the tick engine with AVX2
+ * @param batch - the parameters of the batch
+ * @param queueRHS - space for (max + 1) * 8 vehicles of the right queues
+ * @param queueLHS - space for (max + 1) * 8 vehicles of the left queues
+ * @param stats - receives the statistics of each lane
+ */
+__attribute__((target("avx2")))
+static void run_avx2(struct Batch *batch, int *queueRHS, int *queueLHS, struct LaneStats *stats){
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i laneBit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i streamLo, streamHi;
+    uint32_t drawCounter[2] = {0, 0};
+    /* the lanes where a vehicle arrives at each light on each iteration of the current block */
+    uint32_t arrive[2][ARRIVAL_BLOCK];
+    int blockStart = -ARRIVAL_BLOCK;
+    int lane, i;
+
+    /* the per lane state, index 0 is the right light and 1 the left light */
+    __m256i head[2], tail[2], maxTime[2], clearance[2];
+    __m256 avgTime[2];
+    int *queue[2];
+    queue[0] = queueRHS;
+    queue[1] = queueLHS;
+    for(i = 0; i < 2; i++){
+        head[i] = _mm256_setzero_si256();
+        tail[i] = _mm256_setzero_si256();
+        maxTime[i] = _mm256_setzero_si256();
+        clearance[i] = _mm256_setzero_si256();
+        avgTime[i] = _mm256_setzero_ps();
+    }
+#ifdef SIM_COUNTERS
+    __m256i highWater[2];
+    highWater[0] = _mm256_setzero_si256();
+    highWater[1] = _mm256_setzero_si256();
+#endif
+    stats->blocks = 0;
+    {
+        int lo[8], hi[8];
+        for(lane = 0; lane < 8; lane++){
+            lo[lane] = (int)batch->replication[lane][0];
+            hi[lane] = (int)batch->replication[lane][1];
+        }
+        streamLo = _mm256_loadu_si256((__m256i*)lo);
+        streamHi = _mm256_loadu_si256((__m256i*)hi);
+    }
+
+    /* the light state is shared by every lane, green is 0 when the right light is green and 1 when the left is */
+    int timer[2];
+    timer[0] = batch->lightPeriodRHS;
+    timer[1] = batch->lightPeriodLHS;
+    int green = 0;
+    int iteration = 0;
+
+    while(1){
+        COUNT_PHASE(iteration, batch->max);
+        if(iteration > batch->max){
+            /* count the clearance time of each lane that still has vehicles waiting, and stop once every lane is empty */
+            __m256i waitingRHS = _mm256_xor_si256(_mm256_cmpeq_epi32(head[0], tail[0]), _mm256_set1_epi32(-1));
+            __m256i waitingLHS = _mm256_xor_si256(_mm256_cmpeq_epi32(head[1], tail[1]), _mm256_set1_epi32(-1));
+            clearance[0] = _mm256_sub_epi32(clearance[0], waitingRHS);
+            clearance[1] = _mm256_sub_epi32(clearance[1], waitingLHS);
+            if(_mm256_testz_si256(_mm256_or_si256(waitingRHS, waitingLHS), _mm256_set1_epi32(-1))){
+                break;
+            }
+        }
+
+        /* update the lights exactly as update_light does */
+        if(timer[green] == 0){
+            timer[green] = green == 0 ? batch->lightPeriodRHS : batch->lightPeriodLHS;
+            green = 1 - green;
+            iteration++;
+            continue;
+        }
+        timer[green]--;
+
+        if(iteration < batch->max){
+            /* draw the next block of arrivals once this one is used up, the left light first and the right light
+             * second, as in arrivals_advance */
+            while(iteration >= blockStart + ARRIVAL_BLOCK){
+                draw_avx2(batch, 1, streamLo, streamHi, drawCounter, arrive[1]);
+                draw_avx2(batch, 0, streamLo, streamHi, drawCounter, arrive[0]);
+                blockStart += ARRIVAL_BLOCK;
+                stats->blocks++;
+            }
+
+            /* add a vehicle to the back of the queue of each lane where one arrived, AVX2 has no scatter */
+            for(i = 1; i >= 0; i--){
+                int mask = (int)arrive[i][iteration - blockStart];
+                if(mask != 0){
+                    int slots[8];
+                    _mm256_storeu_si256((__m256i*)slots, tail[i]);
+                    for(lane = 0; lane < 8; lane++){
+                        if(mask & (1 << lane)){
+                            queue[i][slots[lane] * 8 + lane] = iteration;
+                        }
+                    }
+                    /* spread the lane mask out to one bit per lane of a vector */
+                    __m256i arrived = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), laneBit), laneBit);
+                    tail[i] = _mm256_sub_epi32(tail[i], arrived);
+#ifdef SIM_COUNTERS
+                    highWater[i] = _mm256_max_epi32(highWater[i], _mm256_sub_epi32(tail[i], head[i]));
+#endif
+                }
+            }
+        }
+
+        /* remove the first vehicle of the green light's queue in every lane where it is not empty */
+        __m256i waiting = _mm256_xor_si256(_mm256_cmpeq_epi32(head[green], tail[green]), _mm256_set1_epi32(-1));
+        if(!_mm256_testz_si256(waiting, waiting)){
+            __m256i index = _mm256_add_epi32(_mm256_slli_epi32(head[green], 3), laneIndex);
+            __m256i generated = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), queue[green], index, waiting, 4);
+            __m256i wait = _mm256_sub_epi32(_mm256_set1_epi32(iteration), generated);
+            /* head counts the vehicles that have passed, which avgTime is the running mean of */
+            head[green] = _mm256_sub_epi32(head[green], waiting);
+            __m256 avg = _mm256_add_ps(avgTime[green],
+                    _mm256_div_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(wait), avgTime[green]), _mm256_cvtepi32_ps(head[green])));
+            avgTime[green] = _mm256_blendv_ps(avgTime[green], avg, _mm256_castsi256_ps(waiting));
+            maxTime[green] = _mm256_blendv_epi8(maxTime[green], _mm256_max_epi32(maxTime[green], wait), waiting);
+            if(batch->recordWaits){
+                /* without a scatter every lane stores, those with an empty queue into the slot of their next arrival,
+                 * which overwrites it before it is read */
+                int slots[8], waits[8];
+                _mm256_storeu_si256((__m256i*)slots, index);
+                _mm256_storeu_si256((__m256i*)waits, wait);
+                for(lane = 0; lane < 8; lane++){
+                    queue[green][slots[lane]] = waits[lane];
+                }
+            }
+        }
+        iteration++;
+    }
+
+    /* store the statistics of every lane */
+    _mm256_storeu_ps(stats->avgTimeRHS, avgTime[0]);
+    _mm256_storeu_si256((__m256i*)stats->maxTimeRHS, maxTime[0]);
+    _mm256_storeu_si256((__m256i*)stats->numOfVehiclesRHS, tail[0]);
+    _mm256_storeu_si256((__m256i*)stats->clearanceTimeRHS, clearance[0]);
+    _mm256_storeu_ps(stats->avgTimeLHS, avgTime[1]);
+    _mm256_storeu_si256((__m256i*)stats->maxTimeLHS, maxTime[1]);
+    _mm256_storeu_si256((__m256i*)stats->numOfVehiclesLHS, tail[1]);
+    _mm256_storeu_si256((__m256i*)stats->clearanceTimeLHS, clearance[1]);
+#ifdef SIM_COUNTERS
+    _mm256_storeu_si256((__m256i*)stats->highWaterRHS, highWater[0]);
+    _mm256_storeu_si256((__m256i*)stats->highWaterLHS, highWater[1]);
+#endif
+}
+
+/**
+ * mulhi_avx512 gets the high 32 bits of the 64 bit products of each lane of a with the same lane of m
+ * @param a - the 16 values to multiply
+ * @param m - the multiplier in every lane
+ * @return - the high halves of the 16 products
+ */
+__attribute__((target("avx512f")))
+static __m512i mulhi_avx512(__m512i a, __m512i m){
+    __m512i even = _mm512_mul_epu32(a, m);
+    __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+    return _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+}
+
+/**
+ * draw_avx512 draws the arrivals of one light for the next ARRIVAL_BLOCK iterations in all 16 lanes, see draw_avx2
+ * @param batch - the parameters of the batch
+ * @param side - the light to draw for, 0 for the right light and 1 for the left
+ * @param streamLo - the low halves of the stream index of each lane
+ * @param streamHi - the high halves of the stream index of each lane
+ * @param drawCounter - the 64 bit draw counter shared by every lane, which is moved on past the blocks used
+ * @param arrive - receives the mask of lanes where a vehicle arrives, for each iteration of the block
+ */
+__attribute__((target("avx512f")))
+static void draw_avx512(struct Batch *batch, int side, __m512i streamLo, __m512i streamHi, uint32_t drawCounter[2],
+                        uint32_t arrive[ARRIVAL_BLOCK]){
+    const __m512i m0 = _mm512_set1_epi32((int)PHILOX_M0);
+    const __m512i m1 = _mm512_set1_epi32((int)PHILOX_M1);
+    long certain = certain_arrivals(batch->threshold[side], 0xFFFF);
+    int sparse = batch->threshold[side] < ARRIVAL_SPARSE_THRESHOLD;
+    uint32_t sparseWords[ARRIVAL_BLOCK * 16];
+    int block, i;
+    if(certain >= 0){
+        for(i = 0; i < ARRIVAL_BLOCK; i++){
+            arrive[i] = (uint32_t)certain;
+        }
+        return;
+    }
+    const __m512i threshold = _mm512_set1_epi32((int)(uint32_t)batch->threshold[side]);
+    for(block = 0; block < ARRIVAL_BLOCK / 4; block++){
+        __m512i c0 = _mm512_set1_epi32((int)drawCounter[0]);
+        __m512i c1 = _mm512_set1_epi32((int)drawCounter[1]);
+        __m512i c2 = streamLo;
+        __m512i c3 = streamHi;
+        uint32_t k0 = batch->key[0], k1 = batch->key[1];
+        int round;
+        for(round = 0; round < 10; round++){
+            __m512i n0 = _mm512_xor_si512(_mm512_xor_si512(mulhi_avx512(c2, m1), c1), _mm512_set1_epi32((int)k0));
+            __m512i n2 = _mm512_xor_si512(_mm512_xor_si512(mulhi_avx512(c0, m0), c3), _mm512_set1_epi32((int)k1));
+            c1 = _mm512_mullo_epi32(c2, m1);
+            c3 = _mm512_mullo_epi32(c0, m0);
+            c0 = n0;
+            c2 = n2;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        if(sparse){
+            _mm512_storeu_si512(sparseWords + block * 64, c0);
+            _mm512_storeu_si512(sparseWords + block * 64 + 16, c1);
+            _mm512_storeu_si512(sparseWords + block * 64 + 32, c2);
+            _mm512_storeu_si512(sparseWords + block * 64 + 48, c3);
+        }else{
+            arrive[block * 4] = _mm512_cmplt_epu32_mask(c0, threshold);
+            arrive[block * 4 + 1] = _mm512_cmplt_epu32_mask(c1, threshold);
+            arrive[block * 4 + 2] = _mm512_cmplt_epu32_mask(c2, threshold);
+            arrive[block * 4 + 3] = _mm512_cmplt_epu32_mask(c3, threshold);
+        }
+        drawCounter[0]++;
+        if(drawCounter[0] == 0){
+            drawCounter[1]++;
+        }
+    }
+    if(sparse){
+        sparse_arrivals(batch, side, sparseWords, 16, arrive);
+    }
+}
+
+/**
+ * bucket_avx512 works out the histogram bucket of each lane's value, as bucket_avx2 does
+ * @param value - the 16 values, which are never negative
+ * @return - the 16 buckets
+ */
+__attribute__((target("avx512f")))
+static __m512i bucket_avx512(__m512i value){
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512i low = _mm512_castps_si512(_mm512_cvtepi32_ps(_mm512_or_si512(value, one)));
+    __m512i high = _mm512_castps_si512(_mm512_cvtepi32_ps(_mm512_or_si512(_mm512_srli_epi32(value, 8), one)));
+    __m512i top = _mm512_mask_sub_epi32(_mm512_sub_epi32(_mm512_srli_epi32(low, 23), _mm512_set1_epi32(127)),
+                                        _mm512_cmpgt_epi32_mask(value, _mm512_set1_epi32((1 << 24) - 1)),
+                                        _mm512_srli_epi32(high, 23), _mm512_set1_epi32(127 - 8));
+    __m512i shift = _mm512_max_epi32(_mm512_sub_epi32(top, _mm512_set1_epi32(HISTOGRAM_SUB_BITS - 1)),
+                                     _mm512_setzero_si512());
+    return _mm512_add_epi32(_mm512_slli_epi32(shift, HISTOGRAM_SUB_BITS - 1), _mm512_srlv_epi32(value, shift));
+}
+
+/**
+ * record_avx512 adds the waiting times that run_avx512 has left in the queues of one light to its histogram, in the
+ * same two passes as record_avx2
+ * @param histogram - the histogram of the light
+ * @param queue - the queues of the light, holding the waiting time of every vehicle that arrived, which are turned into
+ *                their buckets
+ * @param vehicles - the number of vehicles that arrived in each lane
+ * @param count - the number of lanes to add, the ones whose results are used
+ */
+__attribute__((target("avx512f")))
+static void record_avx512(WaitHistogram *histogram, int *queue, const int *vehicles, int count){
+    const __m512i used = _mm512_loadu_si512(vehicles);
+    int all = (1 << count) - 1;
+    int slot, most;
+    for(slot = 0; _mm512_mask_cmpgt_epi32_mask((__mmask16)all, used, _mm512_set1_epi32(slot)) != 0; slot++){
+        _mm512_storeu_si512(queue + slot * 16, bucket_avx512(_mm512_loadu_si512(queue + slot * 16)));
+    }
+    most = slot;
+    for(slot = 0; slot < most; slot++){
+        int mask = _mm512_mask_cmpgt_epi32_mask((__mmask16)all, used, _mm512_set1_epi32(slot));
+        add_buckets(histogram, queue + slot * 16, mask, all);
+    }
+}
+
+/**
+ * run_avx512 runs 16 lanes of the tick engine with AVX-512, see run_avx2 for the details
+ * @param batch - the parameters of the batch
+ * @param queueRHS - space for (max + 1) * 16 vehicles of the right queues
+ * @param queueLHS - space for (max + 1) * 16 vehicles of the left queues
+ * @param stats - receives the statistics of each lane
+ */
+__attribute__((target("avx512f")))
+static void run_avx512(struct Batch *batch, int *queueRHS, int *queueLHS, struct LaneStats *stats){
+    const __m512i laneIndex = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512i streamLo, streamHi;
+    uint32_t drawCounter[2] = {0, 0};
+    /* the lanes where a vehicle arrives at each light on each iteration of the current block */
+    uint32_t arrive[2][ARRIVAL_BLOCK];
+    int blockStart = -ARRIVAL_BLOCK;
+    int lane, i;
+
+    /* the per lane state, index 0 is the right light and 1 the left light */
+    __m512i head[2], tail[2], maxTime[2], clearance[2];
+    __m512 avgTime[2];
+    int *queue[2];
+    queue[0] = queueRHS;
+    queue[1] = queueLHS;
+    for(i = 0; i < 2; i++){
+        head[i] = _mm512_setzero_si512();
+        tail[i] = _mm512_setzero_si512();
+        maxTime[i] = _mm512_setzero_si512();
+        clearance[i] = _mm512_setzero_si512();
+        avgTime[i] = _mm512_setzero_ps();
+    }
+#ifdef SIM_COUNTERS
+    __m512i highWater[2];
+    highWater[0] = _mm512_setzero_si512();
+    highWater[1] = _mm512_setzero_si512();
+#endif
+    stats->blocks = 0;
+    {
+        int lo[16], hi[16];
+        for(lane = 0; lane < 16; lane++){
+            lo[lane] = (int)batch->replication[lane][0];
+            hi[lane] = (int)batch->replication[lane][1];
+        }
+        streamLo = _mm512_loadu_si512(lo);
+        streamHi = _mm512_loadu_si512(hi);
+    }
+
+    /* the light state is shared by every lane, green is 0 when the right light is green and 1 when the left is */
+    int timer[2];
+    timer[0] = batch->lightPeriodRHS;
+    timer[1] = batch->lightPeriodLHS;
+    int green = 0;
+    int iteration = 0;
+
+    while(1){
+        COUNT_PHASE(iteration, batch->max);
+        if(iteration > batch->max){
+            /* count the clearance time of each lane that still has vehicles waiting, and stop once every lane is empty */
+            __mmask16 waitingRHS = _mm512_cmpneq_epi32_mask(head[0], tail[0]);
+            __mmask16 waitingLHS = _mm512_cmpneq_epi32_mask(head[1], tail[1]);
+            clearance[0] = _mm512_mask_add_epi32(clearance[0], waitingRHS, clearance[0], one);
+            clearance[1] = _mm512_mask_add_epi32(clearance[1], waitingLHS, clearance[1], one);
+            if((waitingRHS | waitingLHS) == 0){
+                break;
+            }
+        }
+
+        /* update the lights exactly as update_light does */
+        if(timer[green] == 0){
+            timer[green] = green == 0 ? batch->lightPeriodRHS : batch->lightPeriodLHS;
+            green = 1 - green;
+            iteration++;
+            continue;
+        }
+        timer[green]--;
+
+        if(iteration < batch->max){
+            /* draw the next block of arrivals once this one is used up, as in run_avx2 */
+            while(iteration >= blockStart + ARRIVAL_BLOCK){
+                draw_avx512(batch, 1, streamLo, streamHi, drawCounter, arrive[1]);
+                draw_avx512(batch, 0, streamLo, streamHi, drawCounter, arrive[0]);
+                blockStart += ARRIVAL_BLOCK;
+                stats->blocks++;
+            }
+
+            /* add a vehicle to the back of the queue of each lane where one arrived */
+            for(i = 1; i >= 0; i--){
+                __mmask16 arrived = (__mmask16)arrive[i][iteration - blockStart];
+                __m512i index = _mm512_add_epi32(_mm512_slli_epi32(tail[i], 4), laneIndex);
+                _mm512_mask_i32scatter_epi32(queue[i], arrived, index, _mm512_set1_epi32(iteration), 4);
+                tail[i] = _mm512_mask_add_epi32(tail[i], arrived, tail[i], one);
+#ifdef SIM_COUNTERS
+                highWater[i] = _mm512_max_epi32(highWater[i], _mm512_sub_epi32(tail[i], head[i]));
+#endif
+            }
+        }
+
+        /* remove the first vehicle of the green light's queue in every lane where it is not empty */
+        __mmask16 waiting = _mm512_cmpneq_epi32_mask(head[green], tail[green]);
+        if(waiting != 0){
+            __m512i index = _mm512_add_epi32(_mm512_slli_epi32(head[green], 4), laneIndex);
+            __m512i generated = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), waiting, index, queue[green], 4);
+            __m512i wait = _mm512_sub_epi32(_mm512_set1_epi32(iteration), generated);
+            /* head counts the vehicles that have passed, which avgTime is the running mean of */
+            head[green] = _mm512_mask_add_epi32(head[green], waiting, head[green], one);
+            __m512 avg = _mm512_add_ps(avgTime[green],
+                    _mm512_div_ps(_mm512_sub_ps(_mm512_cvtepi32_ps(wait), avgTime[green]), _mm512_cvtepi32_ps(head[green])));
+            avgTime[green] = _mm512_mask_mov_ps(avgTime[green], waiting, avg);
+            maxTime[green] = _mm512_mask_max_epi32(maxTime[green], waiting, maxTime[green], wait);
+            if(batch->recordWaits){
+                _mm512_mask_i32scatter_epi32(queue[green], waiting, index, wait, 4);
+            }
+        }
+        iteration++;
+    }
+
+    /* store the statistics of every lane */
+    _mm512_storeu_ps(stats->avgTimeRHS, avgTime[0]);
+    _mm512_storeu_si512(stats->maxTimeRHS, maxTime[0]);
+    _mm512_storeu_si512(stats->numOfVehiclesRHS, tail[0]);
+    _mm512_storeu_si512(stats->clearanceTimeRHS, clearance[0]);
+    _mm512_storeu_ps(stats->avgTimeLHS, avgTime[1]);
+    _mm512_storeu_si512(stats->maxTimeLHS, maxTime[1]);
+    _mm512_storeu_si512(stats->numOfVehiclesLHS, tail[1]);
+    _mm512_storeu_si512(stats->clearanceTimeLHS, clearance[1]);
+#ifdef SIM_COUNTERS
+    _mm512_storeu_si512(stats->highWaterRHS, highWater[0]);
+    _mm512_storeu_si512(stats->highWaterLHS, highWater[1]);
+#endif
+}
+
+/**
+ * simd_lanes gets the number of replications one call of runSimdBatch runs side by side on this CPU
+ * @return - 16 with AVX-512, 8 with AVX2, or 1 if neither is available (the scalar fallback)
+ */
+int simd_lanes(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return 16;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return 8;
+    }
+    return 1;
+}
+
+/**
+ * runSimdBatch runs replications firstReplication to firstReplication + count - 1 of one configuration with the tick
+ * engine, side by side in vector lanes, giving the same results as calling runOneSimulation with VARIATES_PLAIN for
+ * each of them, synced runs are only drawn by the scalar engine
+ * @param arrivalRateLHS - The rate of arrival for the Left light (a integer percentage between 0 and 100)
+ * @param lightPeriodLHS - The period that the Left light stays active for (an integer for the number of iterations)
+ * @param arrivalRateRHS - The rate of arrival for the Right light (a percentage between 0 and 100)
+ * @param lightPeriodRHS - The period that the Left light stays active for (an integer for the number of iterations)
+ * @param seed - The master seed of the run, shared by all replications
+ * @param firstReplication - The index of the first replication of the batch
+ * @param count - The number of replications to run, at most simd_lanes()
+ * @param results - array that receives the result of each replication
+ */
+void runSimdBatch(int arrivalRateLHS,
+                  int lightPeriodLHS,
+                  int arrivalRateRHS,
+                  int lightPeriodRHS,
+                  unsigned long seed,
+                  unsigned long firstReplication,
+                  int count,
+                  ReturnData *results){
+    int lanes = simd_lanes();
+    int lane;
+
+    /* without vector support, or if the queues can't be malloced, fall back to the scalar engine */
+    int *queueRHS = NULL, *queueLHS = NULL;
+    if(lanes > 1){
+        queueRHS = (int*) malloc(sizeof(int) * (ARRIVAL_ITERATIONS + 1) * lanes);
+        queueLHS = (int*) malloc(sizeof(int) * (ARRIVAL_ITERATIONS + 1) * lanes);
+    }
+    if(queueRHS == NULL || queueLHS == NULL){
+        free(queueRHS);
+        free(queueLHS);
+        for(lane = 0; lane < count; lane++){
+            results[lane] = runOneSimulation(arrivalRateLHS, lightPeriodLHS, arrivalRateRHS, lightPeriodRHS,
+                                             seed, firstReplication + lane, ENGINE_TICK, VARIATES_PLAIN);
+        }
+        return;
+    }
+
+    /* set up the parameters shared by every lane, unused lanes just run the following replications */
+    struct Batch batch;
+    batch.lightPeriodLHS = lightPeriodLHS;
+    batch.lightPeriodRHS = lightPeriodRHS;
+    batch.threshold[0] = arrival_threshold(arrivalRateRHS);
+    batch.threshold[1] = arrival_threshold(arrivalRateLHS);
+    int side;
+    for(side = 0; side < 2; side++){
+        batch.logMiss[side] = batch.threshold[side] < ARRIVAL_SPARSE_THRESHOLD ? arrival_log_miss(batch.threshold[side])
+                                                                               : 0;
+    }
+    WaitHistograms *waits = histogram_thread_buffer();
+    batch.recordWaits = waits != NULL;
+    batch.key[0] = (uint32_t)seed;
+    batch.key[1] = (uint32_t)((uint64_t)seed >> 32);
+    for(lane = 0; lane < lanes; lane++){
+        uint64_t replication = firstReplication + lane;
+        batch.replication[lane][0] = (uint32_t)replication;
+        batch.replication[lane][1] = (uint32_t)(replication >> 32);
+    }
+    batch.max = ARRIVAL_ITERATIONS;
+    int used = count < lanes ? count : lanes;
+    batch.used = used;
+
+    struct LaneStats stats;
+    COUNT_START();
+    if(lanes == 16){
+        run_avx512(&batch, queueRHS, queueLHS, &stats);
+    }else{
+        run_avx2(&batch, queueRHS, queueLHS, &stats);
+    }
+    COUNT_END();
+#ifdef SIM_COUNTERS
+    count_lanes(&batch, &stats, used);
+#endif
+    fill_stats(&stats, used, results);
+    /* when recording the waiting times, add those of the lanes that are used to this thread's histograms */
+    if(waits != NULL && lanes == 16){
+        record_avx512(&waits->side[HISTOGRAM_RHS], queueRHS, stats.numOfVehiclesRHS, used);
+        record_avx512(&waits->side[HISTOGRAM_LHS], queueLHS, stats.numOfVehiclesLHS, used);
+    }else if(waits != NULL){
+        record_avx2(&waits->side[HISTOGRAM_RHS], queueRHS, stats.numOfVehiclesRHS, used);
+        record_avx2(&waits->side[HISTOGRAM_LHS], queueLHS, stats.numOfVehiclesLHS, used);
+    }
+
+    free(queueRHS);
+    free(queueLHS);
+}
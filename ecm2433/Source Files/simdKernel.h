@@ -0,0 +1,21 @@
+#ifndef ECM2433___CW_SIMDKERNEL_H
+#define ECM2433___CW_SIMDKERNEL_H
+
+/* Include the runOneSimulation header file for the ReturnData struct */
+#include "runOneSimulation.h"
+
+/* The most replications that one call of runSimdBatch can run side by side (the AVX-512 width) */
+#define SIMD_MAX_LANES 16
+
+/* Declare the functions of simdKernel.c */
+int simd_lanes();
+void runSimdBatch(int arrivalRateLHS,
+                  int lightPeriodLHS,
+                  int arrivalRateRHS,
+                  int lightPeriodRHS,
+                  unsigned long seed,
+                  unsigned long firstReplication,
+                  int count,
+                  ReturnData *results);
+
+#endif
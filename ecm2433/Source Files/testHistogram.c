@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "simHistogram.h"
+
+/*
+ * testHistogram checks the bucket edges of simHistogram, it is run by testSim:
+ *     values below HISTOGRAM_SUB_BUCKETS each have a bucket of their own
+ *     every power of two from HISTOGRAM_SUB_BUCKETS up starts a new bucket
+ *     the buckets never go down as the values go up, and every non-negative int fits
+ *     no bucket is wider than 1 part in HISTOGRAM_SUB_BUCKETS / 2 of its values
+ *     the percentile of a histogram holding one value is the top of that value's bucket
+ *     merging histograms gives the same percentiles in either order
+*/
+
+/* the number of checks that failed */
+static int failures = 0;
+
+/**
+ * check counts a failed check and says which it was
+ * @param ok - whether the check passed
+ * @param what - what was checked
+ * @param value - the value it was checked for
+ */
+static void check(int ok, const char *what, long value){
+    if(!ok){
+        fprintf(stderr, "testHistogram: %s fails for %ld\n", what, value);
+        failures++;
+    }
+}
+
+/**
+ * percentile_of_one gets the percentile of a histogram that holds just one value
+ * @param value - the value
+ * @param percentile - the percentile to get
+ * @return - the percentile
+ */
+static int percentile_of_one(int value, double percentile){
+    WaitHistogram histogram;
+    histogram_init(&histogram);
+    histogram_add(&histogram, value);
+    return histogram_percentile(&histogram, percentile);
+}
+
+/**
+ * check_value checks the bucket of one value against the bucket of the value before it
+ * @param value - the value, at least 1
+ */
+static void check_value(unsigned int value){
+    int bucket = HISTOGRAM_BUCKET(value);
+    int before = HISTOGRAM_BUCKET(value - 1);
+    check(bucket >= 0 && bucket < HISTOGRAM_BUCKETS, "bucket in range", (long)value);
+    check(bucket == before || bucket == before + 1, "buckets go up one at a time", (long)value);
+    if(value < HISTOGRAM_SUB_BUCKETS){
+        check(bucket == (int)value, "exact bucket", (long)value);
+    }
+    if(value >= HISTOGRAM_SUB_BUCKETS && (value & (value - 1)) == 0){
+        check(bucket == before + 1, "power of two starts a bucket", (long)value);
+    }
+    /* working out a percentile scans every bucket, so the tops are only checked where a new bucket starts */
+    if(bucket == before && value <= (1U << 20)){
+        return;
+    }
+    if(bucket == before + 1){
+        check(percentile_of_one((int)value - 1, 50) == (int)value - 1, "top of bucket before", (long)value);
+    }
+    /* the top of the bucket is in the same bucket, and the next value after it is not */
+    int top = percentile_of_one((int)value, 50);
+    check(top >= (int)value && HISTOGRAM_BUCKET((unsigned int)top) == bucket, "top of bucket", (long)value);
+    if(top < INT_MAX){
+        check(HISTOGRAM_BUCKET((unsigned int)top + 1) == bucket + 1, "bucket after top", (long)value);
+    }
+    check((double)(top - (int)value) <= (double)value / (HISTOGRAM_SUB_BUCKETS / 2), "bucket width", (long)value);
+}
+
+/**
+ * main runs every check
+ * @return - EXIT_SUCCESS when every check passes, EXIT_FAILURE when any fails
+ */
+int main(){
+    unsigned int value;
+    int shift, offset, i;
+
+    check(HISTOGRAM_BUCKET(0U) == 0, "exact bucket", 0);
+    /* every value up to 2^20, then the values either side of each higher power of two and the largest int */
+    for(value = 1; value <= (1U << 20); value++){
+        check_value(value);
+    }
+    for(shift = 21; shift < 31; shift++){
+        for(offset = -2; offset <= 2; offset++){
+            check_value((1U << shift) + offset);
+        }
+    }
+    check_value((unsigned int)INT_MAX - 1);
+    check_value((unsigned int)INT_MAX);
+    check(HISTOGRAM_BUCKET((unsigned int)INT_MAX) == HISTOGRAM_BUCKETS - 1, "last bucket", (long)INT_MAX);
+
+    /* merging in either order gives the same histogram */
+    WaitHistogram a, b, ab, ba;
+    histogram_init(&a);
+    histogram_init(&b);
+    for(i = 0; i < 1000; i++){
+        histogram_add(&a, i * 7);
+        histogram_add(&b, i * i);
+    }
+    histogram_init(&ab);
+    histogram_init(&ba);
+    histogram_merge(&ab, &a);
+    histogram_merge(&ab, &b);
+    histogram_merge(&ba, &b);
+    histogram_merge(&ba, &a);
+    for(i = 1; i < 100; i++){
+        check(histogram_percentile(&ab, i) == histogram_percentile(&ba, i), "merge order", i);
+    }
+
+    if(failures > 0){
+        fprintf(stderr, "testHistogram: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "simTrace.h"
+#include "simStats.h"
+
+/*
+ * traceReader maps a trace file written by runSimulations --trace into memory and works out the waiting time
+ * statistics of each light straight from the columns of its blocks, see simTrace.h for the format
+ * usage: traceReader FILE [--replication N]
+*/
+
+/**
+ * read_blocks walks every block of a mapped trace file, adding the waiting time of each record to its light
+ * @param data - the mapped file
+ * @param size - the size of the file
+ * @param replication - the only replication to include, or -1 for all of them
+ * @param waits - receives the waiting times of the vehicles at each light, indexed by TRACE_LHS and TRACE_RHS
+ * @param lastReplication - receives the highest replication seen
+ * @return - an integer to state whether the file was valid(0) or not(1)
+ */
+static int read_blocks(const unsigned char *data, size_t size, long replication, RunningStat *waits,
+                       long *lastReplication){
+    size_t offset = sizeof(TraceHeader);
+    const TraceHeader *header = (const TraceHeader*) data;
+    if(size < sizeof(TraceHeader) || memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0
+                                  || header->version != TRACE_VERSION){
+        fprintf(stderr, "not a trace file\n");
+        return 1;
+    }
+    while(offset < size){
+        const TraceBlock *block = (const TraceBlock*)(data + offset);
+        size_t count, i, length;
+        if(size - offset < sizeof(TraceBlock)){
+            break;
+        }
+        count = block->count;
+        length = sizeof(TraceBlock) + count * 13 + (8 - count % 8) % 8;
+        if(count > TRACE_BLOCK_RECORDS || size - offset < length){
+            fprintf(stderr, "trace block at byte %lu is cut short\n", (unsigned long)offset);
+            return 1;
+        }
+        /* the columns follow the block header one after the other */
+        const int32_t *arrival = (const int32_t*)(block + 1);
+        const int32_t *departure = arrival + count;
+        const uint32_t *replications = (const uint32_t*)(departure + count);
+        const uint8_t *light = (const uint8_t*)(replications + count);
+        for(i = 0; i < count; i++){
+            if(replication >= 0 && replications[i] != (uint32_t)replication){
+                continue;
+            }
+            stat_add(&waits[light[i] == TRACE_LHS ? TRACE_LHS : TRACE_RHS], departure[i] - arrival[i]);
+            if((long)replications[i] > *lastReplication){
+                *lastReplication = replications[i];
+            }
+        }
+        offset += length;
+    }
+    return 0;
+}
+
+/**
+ * main maps the trace file, reads it and prints the statistics of each light
+ * @param argc - the number of arguments
+ * @param argv - the trace file, and optionally --replication N
+ * @return - 1 if the trace was read, 0 if not
+ */
+int main(int argc, char *argv[]){
+    long replication = -1;
+    long lastReplication = -1;
+    RunningStat waits[2];
+    struct stat info;
+    int i;
+    if(argc < 2){
+        fprintf(stderr, "usage: %s FILE [--replication N]\n", argv[0]);
+        return 0;
+    }
+    for(i = 2; i < argc; i++){
+        if(strcmp(argv[i], "--replication") == 0 && i + 1 < argc){
+            replication = atol(argv[++i]);
+        }
+    }
+
+    /* map the whole file, the kernel pages it in as the blocks are read */
+    int fd = open(argv[1], O_RDONLY);
+    if(fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0){
+        fprintf(stderr, "could not open trace file %s\n", argv[1]);
+        return 0;
+    }
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        fprintf(stderr, "could not map trace file %s\n", argv[1]);
+        return 0;
+    }
+    posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+
+    stat_init(&waits[TRACE_LHS]);
+    stat_init(&waits[TRACE_RHS]);
+    int failed = read_blocks((const unsigned char*) data, (size_t)info.st_size, replication, waits, &lastReplication);
+    munmap(data, (size_t)info.st_size);
+    if(failed){
+        return 0;
+    }
+
+    printf("light,vehicles,avgTime,minTime,maxTime,stdDevTime\n");
+    for(i = TRACE_LHS; i <= TRACE_RHS; i++){
+        printf("%s,%ld,%f,%.0f,%.0f,%f\n",
+               i == TRACE_LHS ? "LHS" : "RHS",
+               waits[i].count,
+               waits[i].mean,
+               waits[i].count > 0 ? waits[i].min : 0,
+               waits[i].count > 0 ? waits[i].max : 0,
+               sqrt(stat_variance(&waits[i])));
+    }
+    printf("# %ld replications\n", lastReplication + 1);
+    return 1;
+}
@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "workerPool.h"
+#include "simCounters.h"
+#include "simTrace.h"
+#include "simHistogram.h"
+
+/*
+ * TaskRange is the block of task indices that belongs to one worker
+ * The owner takes tasks from the front (begin) and idle workers steal the back half of it
+ * int begin - the next task index that the owner will run
+ * int end - one past the last task index in this range
+*/
+struct TaskRange {
+    pthread_mutex_t lock;
+    long begin;
+    long end;
+};
+
+/*
+ * Pool is the state shared by all workers of one run_pool call
+*/
+struct Pool {
+    struct TaskRange *ranges;
+    int numWorkers;
+    PoolTask task;
+    void *arg;
+};
+
+/*
+ * Worker is the argument handed to each thread, it holds the shared pool and the index of this worker's range
+*/
+struct Worker {
+    struct Pool *pool;
+    int id;
+};
+
+/**
+ * take_task takes the next task from the front of a worker's own range
+ * @param range - the worker's own range
+ * @param index - set to the task index that was taken
+ * @return - an integer to specify whether a task was taken(1) or the range was empty(0)
+ */
+static int take_task(struct TaskRange *range, long *index){
+    int taken = 0;
+    pthread_mutex_lock(&range->lock);
+    if(range->begin < range->end){
+        *index = range->begin++;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return taken;
+}
+
+/**
+ * steal_tasks moves the back half of another worker's range into the empty range of this worker
+ * @param pool - the pool the workers belong to
+ * @param id - the index of the worker that is stealing
+ * @return - an integer to specify whether any tasks were stolen(1) or every range was empty(0)
+ */
+static int steal_tasks(struct Pool *pool, int id){
+    int offset;
+    /* visit the other workers in turn, starting with the next one along */
+    for(offset = 1; offset < pool->numWorkers; offset++){
+        struct TaskRange *victim = &pool->ranges[(id + offset) % pool->numWorkers];
+        long begin = 0, end = 0;
+        pthread_mutex_lock(&victim->lock);
+        if(victim->begin < victim->end){
+            /* take the back half, rounding up so that a single remaining task can be stolen too */
+            long mid = victim->begin + (victim->end - victim->begin) / 2;
+            begin = mid;
+            end = victim->end;
+            victim->end = mid;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if(begin < end){
+            /* hand the stolen tasks to this worker's own range */
+            struct TaskRange *own = &pool->ranges[id];
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * worker_main is the body of every worker thread, it runs its own tasks and then steals until no work is left
+ * @param data - pointer to the Worker struct for this thread
+ * @return - always NULL
+ */
+static void *worker_main(void *data){
+    struct Worker *worker = (struct Worker*) data;
+    struct Pool *pool = worker->pool;
+    long index;
+    while(1){
+        /* run tasks from this worker's own range until it is empty */
+        while(take_task(&pool->ranges[worker->id], &index)){
+            pool->task(index, pool->arg);
+        }
+        /* once empty, try to steal some work, if there is none left anywhere then this worker is finished */
+        if(steal_tasks(pool, worker->id) == 0){
+            break;
+        }
+    }
+    /* add this thread's instrumentation counts and waiting times to the totals, and write out its trace records, before
+     * it exits */
+    COUNT_FLUSH();
+    trace_thread_done();
+    histogram_thread_done();
+    return NULL;
+}
+
+/**
+ * get_num_cores gets the number of processors available to this process
+ * @return - the number of online processors, at least 1
+ */
+int get_num_cores(){
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cores < 1){
+        return 1;
+    }
+    return (int)cores;
+}
+
+/**
+ * run_pool calls task once for every index between 0 and numTasks - 1, spread over numThreads threads
+ * The order in which tasks run is not defined, so each task should write its result to its own slot
+ * @param numTasks - the number of tasks to run
+ * @param numThreads - the number of worker threads to use, 1 or less runs every task on the calling thread
+ * @param task - the function to call for each task index
+ * @param arg - pointer passed unchanged to every call of task
+ * @return - an integer to state whether the tasks were all run successfully(0) or not(1)
+ */
+int run_pool(long numTasks, int numThreads, PoolTask task, void *arg){
+    long index;
+    int i;
+
+    /* with a single thread (or nothing to split) just run the tasks in order */
+    if(numThreads <= 1 || numTasks <= 1){
+        for(index = 0; index < numTasks; index++){
+            task(index, arg);
+        }
+        COUNT_FLUSH();
+        return 0;
+    }
+    /* there is no use in having more workers than tasks */
+    if(numThreads > numTasks){
+        numThreads = (int)numTasks;
+    }
+
+    /* malloc the space for the ranges, workers and threads */
+    struct Pool pool;
+    pool.ranges = (struct TaskRange*) malloc(sizeof(struct TaskRange) * numThreads);
+    struct Worker *workers = (struct Worker*) malloc(sizeof(struct Worker) * numThreads);
+    pthread_t *threads = (pthread_t*) malloc(sizeof(pthread_t) * numThreads);
+    /* check that these mallocs were successful */
+    if(pool.ranges == NULL || workers == NULL || threads == NULL){
+        free(pool.ranges);
+        free(workers);
+        free(threads);
+        return 1;
+    }
+    pool.numWorkers = numThreads;
+    pool.task = task;
+    pool.arg = arg;
+
+    /* split the tasks into one contiguous range per worker */
+    for(i = 0; i < numThreads; i++){
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        pool.ranges[i].begin = numTasks * i / numThreads;
+        pool.ranges[i].end = numTasks * (i + 1) / numThreads;
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    /* start the workers, the calling thread acts as worker 0 */
+    int started = 1;
+    for(i = 1; i < numThreads; i++){
+        if(pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0){
+            /* the tasks of a worker that could not be started get stolen by the others */
+            break;
+        }
+        started++;
+    }
+    worker_main(&workers[0]);
+    for(i = 1; i < started; i++){
+        pthread_join(threads[i], NULL);
+    }
+
+    /* free the memory used by the pool */
+    for(i = 0; i < numThreads; i++){
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    }
+    free(pool.ranges);
+    free(workers);
+    free(threads);
+    return 0;
+}
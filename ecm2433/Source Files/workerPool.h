@@ -0,0 +1,11 @@
+#ifndef ECM2433___CW_WORKERPOOL_H
+#define ECM2433___CW_WORKERPOOL_H
+
+/* PoolTask is the type of function run by the worker pool, it is called once for every task index */
+typedef void (*PoolTask)(long index, void *arg);
+
+/* Declare the functions of workerPool.c */
+int run_pool(long numTasks, int numThreads, PoolTask task, void *arg);
+int get_num_cores();
+
+#endif